@@ -18,6 +18,8 @@
 
 #include "Font_Manager.h"
 
+#include <algorithm>
+
 /**
  * @brief Instantiates a Font_manager for the given font and raster orientation
  *
@@ -43,18 +45,110 @@ uint8_t Font_Manager::fontcount()
 /**
  * @brief A list of the available fonts
  * 
- * @return the font list
+ * The list is filled on first use; C++11 makes that initialization thread safe.
+ * 
+ * @return the font list, in fonts[] order
  */
 const char **Font_Manager::fontlist()
 {
-    static const char **fontlist = new const char *[NUM_FONTS];
-    for (int i = 0; i < NUM_FONTS; i++)
+    static const char *fontlist[NUM_FONTS];
+    static const bool filled = [] {
+        for (int i = 0; i < NUM_FONTS; i++)
+        {
+            fontlist[i] = fonts[i]->name;
+            if (fontlist[i] == NULL)
+                fontlist[i] = "** Font Name Missing **";
+        }
+        return true;
+    }();
+
+    (void)filled;
+    return fontlist;
+}
+
+/**
+ * @brief The fonts sorted by height, then character set
+ * 
+ * The index is built on first use, as a thread safe static initialization. Fonts of the same
+ * height and character set keep their font index order, regular before bold.
+ * 
+ * @return the font index, fontcount() entries
+ */
+const Font_Manager::font_entry *Font_Manager::font_index()
+{
+    static font_entry index[NUM_FONTS];
+    static const bool built = [] {
+        for (uint8_t i = 0; i < NUM_FONTS; i++)
+        {
+            const char *name = fontlist()[i];
+            Charset charset = strstr(name, "iso8859_1") ? ISO8859_1 : strstr(name, "koi8_r") ? KOI8_R : ASCII;
+            index[i] = {i, fonts[i]->height, charset, name};
+        }
+        std::sort(index, index + NUM_FONTS, [](const font_entry &a, const font_entry &b) {
+            if (a.height != b.height)
+                return a.height < b.height;
+            if (a.charset != b.charset)
+                return a.charset < b.charset;
+            return a.index < b.index;
+        });
+        return true;
+    }();
+
+    (void)built;
+    return index;
+}
+
+/**
+ * @brief Look up a font by name
+ * 
+ * @param name the font name, as fontlist()
+ * @return the font index, or -1 if there is no font of that name
+ */
+int16_t Font_Manager::find_font(const char *name)
+{
+    for (uint8_t i = 0; i < NUM_FONTS; i++)
     {
-        fontlist[i] = fonts[i]->name;
-        if (fontlist[i] == NULL)
-            fontlist[i] = "** Font Name Missing **";
+        if (fonts[i]->name != NULL && !strcmp(fonts[i]->name, name))
+            return i;
     }
-    return fontlist;
+    return -1;
+}
+
+/**
+ * @brief The tallest font a string fits in a box with
+ * 
+ * The index is binary searched for the tallest fonts no higher than the box, then fonts are
+ * measured downward from there until the string fits the box width; the widths come straight
+ * from the font's character descriptors, so nothing is rasterized. Of fonts of the same height
+ * the first in font index order that fits is chosen.
+ * 
+ * @param str the string
+ * @param width the box width
+ * @param height the box height
+ * @param charset the character set of the string, ASCII for any font
+ * @return the font index, or -1 if the string fits no font
+ */
+int16_t Font_Manager::fit_font(const std::string &str, uint16_t width, uint8_t height, Charset charset)
+{
+    const font_entry *index = font_index();
+    int16_t tallest = std::upper_bound(index, index + NUM_FONTS, height,
+                                       [](uint8_t h, const font_entry &e) { return h < e.height; }) -
+                      index;
+    int16_t fit{-1};
+
+    for (int16_t i = tallest - 1; i >= 0; i--)
+    {
+        const font_entry &entry = index[i];
+        if (fit >= 0 && entry.height < fonts[fit]->height)
+            break; // The tallest that fit have all been measured
+        if (charset != ASCII && entry.charset != charset)
+            continue;
+
+        Font_Manager font(entry.index, TBLR);
+        if (font.measure_string(str) <= width && (fit < 0 || entry.index < fit))
+            fit = entry.index;
+    }
+    return fit;
 }
 
 /**
@@ -87,28 +181,42 @@ uint8_t Font_Manager::font_c()
     return (m_font->c);
 }
 
+/**
+ * @brief   Width of a character, with the space after it
+ * 
+ * @param   c  The character
+ * @return  Width of the character and the space after it
+ */
+uint8_t Font_Manager::char_width(unsigned char c)
+{
+    return descriptor(c).width + m_font->c;
+}
+
 /**
  * @brief   Measure width of string with current selected font
  * 
  * @param   str  String to measure
  * @return  Width of the string
  */
-uint16_t Font_Manager::measure_string(std::string str)
+uint16_t Font_Manager::measure_string(const std::string &str)
 {
-    if (str.empty())
-        return 0;
+    return measure_string(str.data(), str.length());
+}
 
+/**
+ * @brief   Measure width of part of a string with current selected font
+ * 
+ * @param   str     First character to measure
+ * @param   length  Number of characters
+ * @return  Width of the characters
+ */
+uint16_t Font_Manager::measure_string(const char *str, uint16_t length)
+{
     uint16_t w = 0;
-    unsigned char c;
 
-    for (std::string::iterator i = str.begin(); i < str.end(); i++)
+    for (const char *i = str; i < str + length; i++)
     {
-        c = *i;
-        // we always have space in the font set
-        if ((c < m_font->char_start) || (c > m_font->char_end))
-            c = ' ';
-        c = c - m_font->char_start;
-        w += m_font->char_descriptors[c].width;
+        w += descriptor(*i).width;
         if (*i)
             w += m_font->c;
     }
@@ -128,16 +236,26 @@ uint16_t Font_Manager::measure_string(std::string str)
  * @param bitoffset The number of bits to shift the bitmap
  * @return Bitmap of the string
  */
-Font_Manager::bitmap Font_Manager::rasterize(std::string str, uint16_t bitoffset)
+Font_Manager::bitmap Font_Manager::rasterize(const std::string &str, uint16_t bitoffset)
+{
+    return rasterize(str.data(), str.length(), bitoffset);
+}
+
+/**
+ * @brief Bitmaps part of a string using the font, shifting the bitmap as required.
+ *
+ * @param str First character to bitmap
+ * @param length Number of characters
+ * @param bitoffset The number of bits to shift the bitmap
+ * @return Bitmap of the characters
+ */
+Font_Manager::bitmap Font_Manager::rasterize(const char *str, uint16_t length, uint16_t bitoffset)
 {
-    bitmap scan(m_raster, measure_string(str), m_font->height, bitoffset);
+    bitmap scan(m_raster, measure_string(str, length), m_font->height, bitoffset);
 
-    for (char &c : str)
+    for (const char *i = str; i < str + length; i++)
     {
-        if ((c < m_font->char_start) || (c > m_font->char_end))
-            c = ' ';
-        c = c - m_font->char_start;
-        raster(c, scan);
+        raster(descriptor(*i), scan);
     };
 
     return scan;
@@ -157,25 +275,50 @@ Font_Manager::bitmap Font_Manager::rasterize(std::string str, uint16_t bitoffset
  */
 Font_Manager::bitmap Font_Manager::rasterize(unsigned char c, uint16_t bitoffset)
 {
-    if ((c < m_font->char_start) || (c > m_font->char_end))
-        c = ' ';
-    c = c - m_font->char_start;
-
-    bitmap scan(m_raster, m_font->char_descriptors[c].width, m_font->height, bitoffset);
+    const font_char_desc_t &char_desc = descriptor(c);
+    bitmap scan(m_raster, char_desc.width, m_font->height, bitoffset);
 
-    raster(c, scan);
+    raster(char_desc, scan);
     return scan;
 }
 
+/**
+ * @brief The descriptor of a character
+ *
+ * Characters outside the font are drawn as spaces, and where the font has no space either, as
+ * a blank with no width.
+ *
+ * @param c the character
+ * @return the character descriptor
+ */
+const font_char_desc_t &Font_Manager::descriptor(unsigned char c)
+{
+    static const font_char_desc_t blank{0, 0};
+
+    if ((c < m_font->char_start) || (c > m_font->char_end))
+        c = ' ';
+    if ((c < m_font->char_start) || (c > m_font->char_end))
+        return blank;
+    return m_font->char_descriptors[c - m_font->char_start];
+}
+
 /**
  * @brief rasterizes a character
  * 
- * @param c character to rasterize
+ * @param char_desc descriptor of the character to rasterize
  * @param scan the output raster scan of the character
  */
-void Font_Manager::raster(unsigned char c, bitmap &bm)
+void Font_Manager::raster(const font_char_desc_t &char_desc, bitmap &bm)
 {
-    font_char_desc_t char_desc = m_font->char_descriptors[c];
+    if (char_desc.width == 0)
+    /*
+     * Nothing to read, the bitmap offset is the next character's
+     */
+    {
+        bm.xpoint += m_font->c;
+        return;
+    }
+
     const uint8_t *bitmap = m_font->bitmap + char_desc.offset;       // Pointer to L-R bitmap
     uint8_t horizontal_read_bytes = 1 + ((char_desc.width - 1) / 8); // Bytes to read for horizontal
     uint8_t *data;                                                   // Data byte placement
@@ -194,6 +337,7 @@ void Font_Manager::raster(unsigned char c, bitmap &bm)
     {
         uint16_t rowdataoffset = bm.width_bytes * ((line + bm.bitheightoffset) / linecoefficient);
         data = bm.data + rowdataoffset + (bm.xpoint / rowcoefficient); // address plus lines plus offset
+        uint8_t *rowend = bm.data + rowdataoffset + bm.width_bytes;     // LRTB line end
 
         for (uint8_t chunk = 0; chunk < horizontal_read_bytes; chunk++)
         /*
@@ -209,7 +353,7 @@ void Font_Manager::raster(unsigned char c, bitmap &bm)
                 * Process the byte into the current location, across byte boundaries if needed
                 */
                 *data++ |= (word >> shiftright); // Font char MSBs shifted to end of destination byte
-                if (shiftright)
+                if (shiftright && data < rowend) // Nothing spills past the end of the line
                 {
                     *data |= (word << (8 - shiftright)); // Font char LSB shifted to start of next destination byte
                 }
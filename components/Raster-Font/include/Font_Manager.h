@@ -20,6 +20,7 @@
 #define INCLUDE_FONT_MANAGER_H_
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <cstring>
 #include <string>
 
@@ -45,6 +46,29 @@ public:
         TBLR,
     };
 
+    /**
+     * @brief Character set of a font's characters above ASCII
+     * 
+     */
+    enum Charset
+    {
+        ASCII,
+        ISO8859_1,
+        KOI8_R,
+    };
+
+    /**
+     * @brief A font in the font index
+     * 
+     */
+    struct font_entry
+    {
+        uint8_t index;    ///< Index of the font in fonts[]
+        uint8_t height;   ///< Character height in pixels
+        Charset charset;  ///< Character set
+        const char *name; ///< Font name
+    };
+
     /**
      * @brief Contains data for rastered content and its placement 
      * 
@@ -95,7 +119,7 @@ public:
 
         ~bitmap()
         {
-            delete[] data;
+            free(data);
         }
     };
 
@@ -107,11 +131,17 @@ public:
 
     static uint8_t fontcount();
     static const char **fontlist();
+    static const font_entry *font_index();
+    static int16_t find_font(const char *name);
+    static int16_t fit_font(const std::string &str, uint16_t width, uint8_t height, Charset charset = ASCII);
     const virtual char *font_name();
     uint8_t font_height();
     uint8_t font_c();
-    uint16_t measure_string(std::string str);
-    bitmap rasterize(std::string str, uint16_t bitoffset = 0);
+    uint8_t char_width(unsigned char c);
+    uint16_t measure_string(const std::string &str);
+    uint16_t measure_string(const char *str, uint16_t length);
+    bitmap rasterize(const std::string &str, uint16_t bitoffset = 0);
+    bitmap rasterize(const char *str, uint16_t length, uint16_t bitoffset = 0);
     bitmap rasterize(unsigned char c, uint16_t bitoffset = 0);
 
 private:
@@ -120,7 +150,8 @@ private:
 
     Raster m_raster; ///< The raster type of this Font Manager
 
-    void raster(unsigned char c, bitmap &scan);
+    const font_char_desc_t &descriptor(unsigned char c);
+    void raster(const font_char_desc_t &char_desc, bitmap &scan);
 };
 
 #endif /* INCLUDE_FONT_MANAGER_H_ */
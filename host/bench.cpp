@@ -0,0 +1,247 @@
+/*
+ ESP32-SSD1306-Driver Library Host Benchmarks
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Times the drawing primitives, text in every font, and refreshes of various dirty patterns on
+ * a 128x64 panel, also rotated, and a 128x32 panel single and double buffered, driven through
+ * the emulated PIF. Each benchmark repeats its operation for at least the minimum time, and
+ * reports ns per operation; refreshes also report the bytes each frame puts on the bus.
+ *
+ *   bench [filter] [--ms minimum milliseconds per benchmark]
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Emulated_PIF.h"
+#include "OLED.h"
+
+static Emulated_PIF pif;
+static SSD1306_Panel<128, 64> panel(&pif);
+static OLED display(panel);
+static SSD1306_Panel<128, 32> panel32(&pif);
+
+static const char *filter{nullptr}; ///< Only run benchmarks whose name contains this
+static uint32_t minimum_ms{200};    ///< Minimum run time of each benchmark
+
+/**
+ * @brief Fast repeatable pseudo-random numbers, so drawing varies without costing much
+ */
+static uint32_t rnd()
+{
+    static uint32_t x{2463534242};
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/**
+ * @brief Run and report a benchmark
+ *
+ * @param name the benchmark name
+ * @param op the operation to time
+ * @param refresh report the bus bytes per operation
+ */
+template <typename F>
+static void bench(const char *name, F op, bool refresh = false)
+{
+    if (filter && !strstr(name, filter))
+        return;
+
+    typedef std::chrono::steady_clock clock;
+    uint64_t iterations{0};
+    double elapsed{0};
+
+    op(); // Warm up
+    pif.reset_counters();
+
+    for (uint64_t batch = 1; elapsed < minimum_ms * 1e6; batch *= 2)
+    {
+        clock::time_point start = clock::now();
+        for (uint64_t i = 0; i < batch; i++)
+        {
+            op();
+        }
+        elapsed += std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        iterations += batch;
+    }
+
+    if (refresh)
+        printf("%-40s %12.1f ns/op %10.1f bytes/frame\n", name, elapsed / iterations, (double)pif.bytes / iterations);
+    else
+        printf("%-40s %12.1f ns/op\n", name, elapsed / iterations);
+}
+
+static void primitives()
+{
+    bench("pixel", [] { display.draw_pixel(rnd() & 127, rnd() & 63, INVERT); });
+    bench("hline", [] { display.draw_hline(rnd() & 63, rnd() & 63, 64, INVERT); });
+    bench("vline", [] { display.draw_vline(rnd() & 127, rnd() & 31, 32, INVERT); });
+    bench("line", [] { display.draw_line(rnd() & 127, rnd() & 63, rnd() & 127, rnd() & 63, INVERT); });
+    bench("draw_rectangle 32x16", [] { display.draw_rectangle(rnd() & 63, rnd() & 31, 32, 16, INVERT); });
+    bench("fill_rectangle 32x16", [] { display.fill_rectangle(rnd() & 63, rnd() & 31, 32, 16, INVERT); });
+    bench("fill_rectangle 128x64", [] { display.fill_rectangle(0, 0, 128, 64, INVERT); });
+    bench("draw_circle r15", [] { display.draw_circle(16 + (rnd() & 63), 16 + (rnd() & 31), 15, INVERT); });
+    bench("fill_circle r15", [] { display.fill_circle(16 + (rnd() & 63), 16 + (rnd() & 31), 15, INVERT); });
+    bench("clear", [] { display.clear(); });
+    bench("clear limit", [] { display.clear(true); });
+}
+
+static void text()
+{
+    char name[64];
+    for (uint8_t i = 0; i < Font_Manager::fontcount(); i++)
+    {
+        display.select_font(i);
+        snprintf(name, sizeof(name), "draw_string %s", display.font_name());
+        bench(name, [] { display.draw_string(rnd() & 15, rnd() & 15, "ESP32-SSD1306", WHITE, BLACK); });
+    }
+
+    display.select_font(0);
+    bench("draw_string_scaled glcd_5x7 2x",
+          [] { display.draw_string_scaled(rnd() & 15, rnd() & 15, "12:45", 2, WHITE, BLACK); });
+    bench("draw_string_scaled glcd_5x7 4x",
+          [] { display.draw_string_scaled(rnd() & 15, rnd() & 15, "12:45", 4, WHITE, BLACK); });
+    display.select_style(STYLE_BOLD | STYLE_UNDERLINE);
+    bench("draw_string bold underlined",
+          [] { display.draw_string(rnd() & 15, rnd() & 15, "ESP32-SSD1306", WHITE, BLACK); });
+    display.select_style(STYLE_NORMAL);
+    bench("draw_string transparent",
+          [] { display.draw_string(rnd() & 15, rnd() & 15, "ESP32-SSD1306", WHITE, TRANSPARENT); });
+    bench("draw_text wrapped",
+          [] {
+              display.draw_text(0, 0, 64, 40, "The quick brown fox jumps over the lazy dog", WHITE, BLACK, ALIGN_CENTER,
+                                LAYOUT_WRAP | LAYOUT_ELLIPSIS);
+          });
+    bench("draw_text wrapped, laid out each time",
+          [] {
+              static std::string str("The quick brown fox jumps over the lazy dog ?");
+              str.back() = 'A' + (rnd() & 31);
+              display.draw_text(0, 0, 64, 40, str, WHITE, BLACK, ALIGN_CENTER, LAYOUT_WRAP | LAYOUT_ELLIPSIS);
+          });
+    bench("fit_font", [] { Font_Manager::fit_font("21.5C", 20 + (rnd() & 63), 7 + (rnd() & 31)); });
+    static Numeric_Field field(40, 27, 0, 5, 0, true);
+    bench("draw_number counter",
+          [] {
+              static uint16_t count{0};
+              display.draw_number(field, count++);
+          });
+    bench("draw_string_vertical",
+          [] { display.draw_string_vertical(rnd() & 63, rnd() & 7, "ESP32-SSD1306", WHITE, BLACK); });
+}
+
+static void refreshes()
+{
+    bench("refresh clean", [] { display.refresh(); }, true);
+    bench("refresh force", [] { display.draw_pixel(64, 32, INVERT).refresh(true); }, true);
+    bench("refresh 1 pixel", [] { display.draw_pixel(64, 32, INVERT).refresh(); }, true);
+    bench("refresh 8x8 box", [] { display.fill_rectangle(60, 24, 8, 8, INVERT).refresh(); }, true);
+    bench("refresh 1 page", [] { display.draw_hline(0, 8, 128, INVERT).refresh(); }, true);
+    bench("refresh opposite corners", [] { display.draw_pixel(0, 0, INVERT).draw_pixel(127, 63, INVERT).refresh(); },
+          true);
+    bench("refresh 16 scattered pixels",
+          [] {
+              for (uint8_t i = 0; i < 16; i++)
+              {
+                  display.draw_pixel(rnd() & 127, rnd() & 63, INVERT);
+              }
+              display.refresh();
+          },
+          true);
+    bench("refresh full screen draw", [] { display.fill_rectangle(0, 0, 128, 64, INVERT).refresh(); }, true);
+    bench("refresh clear and redraw sparse",
+          [] {
+              static uint8_t x{0};
+              display.clear();
+              display.draw_string(0, 0, "ESP32-SSD1306", WHITE, BLACK);
+              display.fill_rectangle(x++ & 127, 40, 8, 8, WHITE).refresh();
+          },
+          true);
+    bench("refresh opaque counter",
+          [] {
+              static uint16_t count{0};
+              char digits[8];
+              snprintf(digits, sizeof(digits), "%05u", count++);
+              display.draw_string(40, 27, digits, WHITE, BLACK).refresh();
+          },
+          true);
+    static Numeric_Field field(40, 27, 0, 5, 0, true);
+    bench("refresh numeric field counter",
+          [] {
+              static uint16_t count{0};
+              display.draw_number(field, count++).refresh();
+          },
+          true);
+
+    /*
+     * A sprite moving on a 128x32 panel, written in place and page flipped
+     */
+    auto sprite = [] {
+        static uint8_t x{0};
+        panel32.box(x & 127, 12, BLACK, 8, 8);
+        panel32.box(++x & 127, 12, WHITE, 8, 8);
+        panel32.refresh(false);
+    };
+    bench("refresh 128x32 moving box", sprite, true);
+    panel32.double_buffer(true);
+    bench("refresh 128x32 moving box flipped", sprite, true);
+    panel32.double_buffer(false);
+
+    /*
+     * Portrait, drawn 64x128 and transposed into the panel pages as refreshed
+     */
+    panel.orientation(ORIENTATION_90);
+    bench("refresh rotated 8x8 box",
+          [] {
+              panel.box(28, 60, INVERT, 8, 8);
+              panel.refresh(false);
+          },
+          true);
+    bench("refresh rotated full screen draw",
+          [] {
+              panel.box(0, 0, INVERT, 64, 128);
+              panel.refresh(false);
+          },
+          true);
+    panel.orientation(ORIENTATION_0);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--ms") && i + 1 < argc)
+            minimum_ms = atoi(argv[++i]);
+        else
+            filter = argv[i];
+    }
+
+    panel.init();
+    panel.transaction_overhead(2); // The emulated bus's address and control bytes
+    panel32.init();
+    panel32.transaction_overhead(2);
+    display.select_font(0);
+
+    primitives();
+    text();
+    refreshes();
+    return 0;
+}
@@ -0,0 +1,257 @@
+/*
+ ESP32-SSD1306-Driver Library Emulated Panel Protocol Interface
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_EMULATED_PIF_H_
+#define SSD1306_EMULATED_PIF_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "PIF.h"
+
+/**
+ * @brief PIF emulating the panel controller, for host builds
+ *
+ * Commands are decoded and data written into an emulated GDDRAM following the controller's
+ * addressing modes, so the panel contents can be checked against the display buffer. The bus
+ * traffic is counted as it would be on I2C, each transaction carrying an address and a control
+ * byte.
+ */
+class Emulated_PIF : public PIF
+{
+    public:
+
+        static const constexpr uint8_t PAGES = 8;       ///< GDDRAM pages, 64 rows
+        static const constexpr uint8_t COLUMNS = 132;   ///< GDDRAM columns, enough for the SH1106
+
+        uint32_t bytes { 0 };           ///< Bytes on the bus, including address and control bytes
+        uint32_t transactions { 0 };    ///< Bus transactions
+        uint32_t data_bytes { 0 };      ///< GDDRAM bytes written
+
+        Emulated_PIF()
+        {
+            memset( m_gddram, 0, sizeof ( m_gddram ) );
+        }
+
+        virtual ~Emulated_PIF()
+        {
+        }
+
+        virtual void info()
+        {
+            printf( "Emulated panel: %d bytes in %d transactions\n", bytes, transactions );
+        }
+
+        bool command(const uint8_t cmd )
+        {
+            return command( &cmd, 1 );
+        }
+
+        bool command(const uint8_t* cmd, uint8_t size )
+        {
+            count( size );
+            for ( uint8_t i = 0; i < size; i++ )
+            {
+                decode( cmd[i] );
+            }
+            return true;
+        }
+
+        bool data( uint8_t* data, uint8_t size )
+        {
+            count( size );
+            data_bytes += size;
+            for ( uint8_t i = 0; i < size; i++ )
+            {
+                write( data[i] );
+            }
+            return true;
+        }
+
+        /**
+         * @brief Zero the traffic counters
+         */
+        void reset_counters()
+        {
+            bytes = transactions = data_bytes = 0;
+        }
+
+        /**
+         * @brief A GDDRAM byte
+         * @param page
+         * @param column
+         * @return the byte
+         */
+        uint8_t gddram( uint8_t page, uint8_t column )
+        {
+            return m_gddram[page][column];
+        }
+
+        /**
+         * @brief Copy the visible GDDRAM out as a page format frame
+         *
+         * Panels show the rows from the display start line on, wrapping at 64.
+         *
+         * @param frame frame of width * pages bytes
+         * @param width visible columns
+         * @param height visible rows
+         * @param columnoffset first GDDRAM column shown
+         */
+        void frame( uint8_t* frame, uint8_t width, uint8_t height, uint8_t columnoffset = 0 )
+        {
+            for ( uint8_t page = 0; page < ( height + 7 ) / 8 && page < PAGES; page++ )
+            {
+                uint8_t shown = ( page + m_startline / 8 ) % 8;
+                memcpy( frame + page * width, &m_gddram[shown][columnoffset], width );
+            }
+        }
+
+        /**
+         * @brief The display start line, the GDDRAM row shown at the top
+         */
+        uint8_t start_line()
+        {
+            return m_startline;
+        }
+
+        /**
+         * @brief Whether the panel is switched on
+         */
+        bool on()
+        {
+            return m_on;
+        }
+
+    private:
+
+        uint8_t m_gddram[PAGES][COLUMNS];
+        bool m_on { false };
+        uint8_t m_mode { 2 };    ///< Addressing mode, page addressing at reset
+        uint8_t m_colstart { 0 }, m_colend { 127 }, m_pagestart { 0 }, m_pageend { 7 };
+        uint8_t m_column { 0 }, m_page { 0 };    ///< GDDRAM pointer
+        uint8_t m_startline { 0 };               ///< Display start line
+        uint8_t m_cmd[8];                        ///< Command being decoded
+        uint8_t m_cmdlen { 0 };
+
+        void count( uint8_t size )
+        {
+            bytes += size + 2;
+            transactions++;
+        }
+
+        /**
+         * @brief Number of argument bytes following a command
+         */
+        static uint8_t arguments( uint8_t cmd )
+        {
+            switch ( cmd )
+            {
+                case 0x21: case 0x22: case 0xa3:
+                    return 2;
+                case 0x20: case 0x81: case 0x8d: case 0xa8: case 0xad: case 0xd3: case 0xd5: case 0xd9: case 0xda: case 0xdb:
+                    return 1;
+                case 0x26: case 0x27:
+                    return 6;
+                case 0x29: case 0x2a:
+                    return 5;
+                default:
+                    return 0;
+            }
+        }
+
+        void decode( uint8_t byte )
+        {
+            m_cmd[m_cmdlen++] = byte;
+            if ( m_cmdlen <= arguments( m_cmd[0] ) )
+            {
+                return;
+            }
+            m_cmdlen = 0;
+
+            uint8_t cmd = m_cmd[0];
+            switch ( cmd )
+            {
+                case 0x20:
+                    m_mode = m_cmd[1] & 0x03;
+                    break;
+                case 0x21:
+                    m_colstart = m_column = m_cmd[1];
+                    m_colend = m_cmd[2];
+                    break;
+                case 0x22:
+                    m_pagestart = m_page = m_cmd[1] & 0x0f;
+                    m_pageend = m_cmd[2] & 0x0f;
+                    break;
+                case 0xae:
+                    m_on = false;
+                    break;
+                case 0xaf:
+                    m_on = true;
+                    break;
+                default:
+                    if ( cmd <= 0x0f )
+                    {
+                        m_column = ( m_column & 0xf0 ) | cmd;
+                    }
+                    else if ( cmd >= 0x10 && cmd <= 0x1f )
+                    {
+                        m_column = ( m_column & 0x0f ) | ( ( cmd & 0x0f ) << 4 );
+                    }
+                    else if ( cmd >= 0x40 && cmd <= 0x7f )
+                    {
+                        m_startline = cmd & 0x3f;
+                    }
+                    else if ( cmd >= 0xb0 && cmd <= 0xbf )
+                    {
+                        m_page = cmd & 0x0f;
+                    }
+            }
+        }
+
+        void write( uint8_t byte )
+        {
+            if ( m_page < PAGES && m_column < COLUMNS )
+            {
+                m_gddram[m_page][m_column] = byte;
+            }
+
+            if ( m_mode == 2 )
+            /*
+             * Page addressing, the column runs on within the page
+             */
+            {
+                if ( m_column < COLUMNS - 1 )
+                {
+                    m_column++;
+                }
+                return;
+            }
+
+            if ( m_column++ >= m_colend )
+            /*
+             * Horizontal addressing, wraps to the next page of the window
+             */
+            {
+                m_column = m_colstart;
+                m_page = m_page >= m_pageend ? m_pagestart : m_page + 1;
+            }
+        }
+};
+
+#endif  // SSD1306_EMULATED_PIF_H_
@@ -0,0 +1,126 @@
+/*
+ ESP32-SSD1306-Driver Library PBM images
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_PBM_H_
+#define SSD1306_PBM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief Page format frames to and from binary PBM (P4) images, for host tools
+ *
+ * Frames are laid out as the display buffer: pages of 8 rows, a byte per column, LSB on top.
+ * Lit pixels are black in the PBM.
+ */
+class PBM
+{
+    public:
+
+        /**
+         * @brief Write a frame as a PBM image
+         * @param path file to write
+         * @param width frame width
+         * @param height frame height
+         * @param frame page format frame
+         * @return true if written
+         */
+        static bool write( const char* path, uint16_t width, uint16_t height, const uint8_t* frame )
+        {
+            FILE* f = fopen( path, "wb" );
+            if ( f == nullptr )
+            {
+                return false;
+            }
+
+            fprintf( f, "P4\n%d %d\n", width, height );
+            std::vector<uint8_t> line( ( width + 7 ) / 8 );
+            for ( uint16_t y = 0; y < height; y++ )
+            {
+                std::fill( line.begin(), line.end(), 0 );
+                for ( uint16_t x = 0; x < width; x++ )
+                {
+                    if ( pixel( frame, width, x, y ) )
+                    {
+                        line[x / 8] |= 0x80 >> ( x % 8 );
+                    }
+                }
+                fwrite( line.data(), 1, line.size(), f );
+            }
+            return fclose( f ) == 0;
+        }
+
+        /**
+         * @brief Read a PBM image written by write()
+         * @param path file to read
+         * @param width frame width, set
+         * @param height frame height, set
+         * @param frame page format frame, set
+         * @return true if read
+         */
+        static bool read( const char* path, uint16_t& width, uint16_t& height, std::vector<uint8_t>& frame )
+        {
+            FILE* f = fopen( path, "rb" );
+            if ( f == nullptr )
+            {
+                return false;
+            }
+
+            int w, h;
+            if ( fscanf( f, "P4 %d %d", &w, &h ) != 2 || fgetc( f ) == EOF || w <= 0 || h <= 0 )
+            {
+                fclose( f );
+                return false;
+            }
+
+            width = w;
+            height = h;
+            frame.assign( width * ( ( height + 7 ) / 8 ), 0 );
+            std::vector<uint8_t> line( ( width + 7 ) / 8 );
+            for ( uint16_t y = 0; y < height; y++ )
+            {
+                if ( fread( line.data(), 1, line.size(), f ) != line.size() )
+                {
+                    fclose( f );
+                    return false;
+                }
+                for ( uint16_t x = 0; x < width; x++ )
+                {
+                    if ( line[x / 8] & ( 0x80 >> ( x % 8 ) ) )
+                    {
+                        frame[( y / 8 ) * width + x] |= 1 << ( y % 8 );
+                    }
+                }
+            }
+            fclose( f );
+            return true;
+        }
+
+        /**
+         * @brief A pixel of a page format frame
+         */
+        static bool pixel( const uint8_t* frame, uint16_t width, uint16_t x, uint16_t y )
+        {
+            return frame[( y / 8 ) * width + x] & ( 1 << ( y % 8 ) );
+        }
+};
+
+#endif  // SSD1306_PBM_H_
@@ -0,0 +1,260 @@
+/*
+ ESP32-SSD1306-Driver Library Host Trace Replay
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Replays a Trace_PIF trace into the emulated panel, reconstructing each frame, and reports the
+ * time, bus bytes, transactions and failed transfers of each. Frames end at the trace's frame
+ * records or, with --gap, wherever the traffic pauses for at least that many microseconds.
+ *
+ *   replay trace [--size WxH] [--sh1106] [--gap us] [--out directory] [--resend] [--quiet]
+ *
+ * --out writes each frame as a PBM image. --resend draws the changes between frames into the
+ * driver, as the application would, and refreshes them into a second emulated panel, comparing
+ * the driver's traffic with the recorded traffic: the trace as a workload for refresh changes.
+ *
+ * Failed transfers are counted but not replayed, as the panel did not acknowledge them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "Emulated_PIF.h"
+#include "PBM.h"
+#include "SSD1306.h"
+#include "Trace_PIF.h"
+
+static uint8_t width{128}, height{64};
+static controller_t controller{CONTROLLER_SSD1306};
+static uint32_t gap{0};             ///< Traffic pause that ends a frame, microseconds, 0 for none
+static const char *out_dir{nullptr}; ///< Frame images
+static bool resend{false};          ///< Re-drive the frames through the driver
+static bool quiet{false};           ///< Totals only
+
+/**
+ * @brief Traffic of a frame, or of the trace
+ */
+struct traffic_t
+{
+    uint64_t us;           ///< Duration
+    uint32_t bytes;        ///< Bus bytes, including address and control bytes
+    uint32_t transactions; ///< Bus transactions
+    uint32_t failed;       ///< Failed transfers
+};
+
+static Emulated_PIF recorded;
+static Emulated_PIF driven;
+static SSD1306 *driver{nullptr};
+
+static std::vector<uint8_t> frame, previous;
+static uint32_t frames{0};
+static traffic_t current{0, 0, 0, 0}, total{0, 0, 0, 0};
+static uint32_t driven_bytes{0}, driven_transactions{0}, mismatches{0};
+
+/**
+ * @brief Read an unsigned LEB128 varint
+ */
+static bool varint(FILE *f, uint32_t &value)
+{
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7)
+    {
+        int c = fgetc(f);
+        if (c == EOF)
+            return false;
+        value |= static_cast<uint32_t>(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Draw the changes since the last frame into the driver and refresh
+ *
+ * Each page's changed columns are blitted, so the dirty window is as the drawing would leave it.
+ */
+static void redrive()
+{
+    driven.reset_counters();
+
+    for (uint8_t page = 0; page < height / 8; page++)
+    {
+        const uint8_t *now = &frame[page * width], *before = &previous[page * width];
+        int16_t left{0}, right{static_cast<int16_t>(width - 1)};
+        while (left <= right && now[left] == before[left])
+            left++;
+        while (right >= left && now[right] == before[right])
+            right--;
+        if (left > right)
+            continue;
+
+        image_t strip{static_cast<uint16_t>(right - left + 1), 8, IMAGE_TBLR, now + left, nullptr};
+        driver->blit(left, page * 8, strip, ROP_COPY);
+    }
+    driver->refresh(false);
+
+    driven_bytes += driven.bytes;
+    driven_transactions += driven.transactions;
+
+    std::vector<uint8_t> check(frame.size());
+    driven.frame(check.data(), width, height, panel_geometry(width, height, controller).columnoffset);
+    if (check != frame)
+        mismatches++;
+}
+
+/**
+ * @brief End the frame: report it, write its image and re-drive it
+ */
+static void end_frame()
+{
+    if (current.transactions == 0)
+        return;
+
+    recorded.frame(frame.data(), width, height, panel_geometry(width, height, controller).columnoffset);
+
+    if (!quiet)
+        printf("frame %5u %10.3f ms %6u bytes %4u transactions %3u failed\n", frames, current.us / 1000.0,
+               current.bytes, current.transactions, current.failed);
+
+    if (out_dir)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/frame_%05u.pbm", out_dir, frames);
+        if (!PBM::write(path, width, height, frame.data()))
+            fprintf(stderr, "cannot write %s\n", path);
+    }
+
+    if (resend)
+        redrive();
+
+    previous = frame;
+    frames++;
+    current = traffic_t{0, 0, 0, 0};
+}
+
+int main(int argc, char **argv)
+{
+    const char *path{nullptr};
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--size") && i + 1 < argc)
+        {
+            unsigned w, h;
+            if (sscanf(argv[++i], "%ux%u", &w, &h) != 2 || w == 0 || w > 132 || h == 0 || h > 64 || h % 8)
+            {
+                fprintf(stderr, "bad size %s\n", argv[i]);
+                return 2;
+            }
+            width = w;
+            height = h;
+        }
+        else if (!strcmp(argv[i], "--sh1106"))
+            controller = CONTROLLER_SH1106;
+        else if (!strcmp(argv[i], "--gap") && i + 1 < argc)
+            gap = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+            out_dir = argv[++i];
+        else if (!strcmp(argv[i], "--resend"))
+            resend = true;
+        else if (!strcmp(argv[i], "--quiet"))
+            quiet = true;
+        else
+            path = argv[i];
+    }
+
+    if (path == nullptr)
+    {
+        fprintf(stderr, "usage: replay trace [--size WxH] [--sh1106] [--gap us] [--out directory] [--resend] [--quiet]\n");
+        return 2;
+    }
+
+    FILE *f = fopen(path, "rb");
+    uint8_t header[5];
+    if (f == nullptr || fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, "SSDT", 4) ||
+        header[4] != Trace_PIF::VERSION)
+    {
+        fprintf(stderr, "%s is not a version %d trace\n", path, Trace_PIF::VERSION);
+        return 2;
+    }
+
+    frame.assign(width * (height / 8), 0);
+    previous = frame;
+
+    if (resend)
+    {
+        driver = new SSD1306(&driven, panel_geometry(width, height, controller));
+        driver->init();
+        driver->transaction_overhead(2); // The emulated bus's address and control bytes
+    }
+
+    uint8_t bytes[256];
+    int type;
+    while ((type = fgetc(f)) != EOF)
+    {
+        uint32_t delta;
+        if (!varint(f, delta))
+            break;
+
+        uint8_t kind = type & ~Trace_PIF::TRACE_FAILED;
+        if (kind == Trace_PIF::TRACE_FRAME)
+        {
+            current.us += delta;
+            total.us += delta;
+            end_frame();
+            continue;
+        }
+
+        int size = fgetc(f);
+        if (size == EOF || fread(bytes, 1, size, f) != static_cast<size_t>(size))
+            break;
+
+        if (gap && delta >= gap)
+            end_frame();
+        else
+            current.us += delta;
+        total.us += delta;
+
+        uint32_t before{recorded.bytes}, transactions{recorded.transactions};
+        if (type & Trace_PIF::TRACE_FAILED)
+        {
+            current.failed++;
+            total.failed++;
+        }
+        else if (kind == Trace_PIF::TRACE_COMMAND)
+            recorded.command(bytes, size);
+        else
+            recorded.data(bytes, size);
+
+        current.bytes += recorded.bytes - before;
+        current.transactions += recorded.transactions - transactions;
+    }
+    end_frame();
+    fclose(f);
+
+    printf("%u frames, %.3f ms, %u bytes, %u transactions, %u failed\n", frames, total.us / 1000.0, recorded.bytes,
+           recorded.transactions, total.failed);
+    if (resend)
+        printf("driver resend: %u bytes, %u transactions, %u frames differ\n", driven_bytes, driven_transactions,
+               mismatches);
+
+    delete driver;
+    return 0;
+}
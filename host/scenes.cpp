@@ -0,0 +1,450 @@
+/*
+ ESP32-SSD1306-Driver Library Host Golden Scenes
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Renders the example scenes - rectangles, lines, circles, vertical, opaque, scaled, styled,
+ * wrapped and fitted text, numeric fields, a virtual screen and every font - through OLED onto a 128x64 emulated panel, and compares
+ * what reached the panel GDDRAM against the golden PBM images. Random scenes use a fixed seed, so every run draws the same
+ * frames. A scene that differs has its frame and a diff image, set where the pixels differ,
+ * written to the output directory, and the exit status is the number of failing scenes.
+ *
+ *   scenes [filter] [--update] [--golden directory] [--out directory] [--trace file]
+ *
+ * --update rewrites the goldens from the current rendering, after a deliberate drawing change.
+ * --trace records the panel traffic with Trace_PIF, a frame per scene, for replay.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Emulated_PIF.h"
+#include "OLED.h"
+#include "PBM.h"
+#include "Trace_PIF.h"
+
+#ifndef GOLDEN_DIR
+#define GOLDEN_DIR "golden"
+#endif
+
+static const uint8_t WIDTH = 128, HEIGHT = 64;
+
+static Emulated_PIF pif;
+static Trace_PIF *trace{nullptr};
+static SSD1306 *panel;
+static OLED *display;
+
+static const char *filter{nullptr};        ///< Only render scenes whose name contains this
+static const char *golden_dir{GOLDEN_DIR}; ///< Golden images
+static const char *out_dir{"."};           ///< Failing frames and diffs
+static bool update{false};                 ///< Rewrite the goldens
+static const char *trace_path{nullptr};    ///< Record the traffic, a frame per scene
+
+static uint32_t seed;
+
+/**
+ * @brief Repeatable stand in for esp_random(), reseeded for each scene
+ */
+static uint32_t rnd()
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+/*
+ * The app_main scenes, with the delays dropped and esp_random() seeded
+ */
+
+static void rectangle()
+{
+    display->clear();
+    for (uint8_t d = 0; d < 18; d++)
+    {
+        display->draw_pixel(d * 8, 2 * d + 0, WHITE).fill_rectangle(2 + (d * 8), 1, 3, 2 * d, WHITE);
+        display->draw_pixel(d * 8, 2 * d + 34, WHITE).draw_rectangle(2 + (d * 8), 35, 3, 2 * d, WHITE);
+    }
+    display->refresh(true);
+}
+
+static void circles()
+{
+    display->clear();
+    for (int i = 0; i < 10; i++)
+    {
+        uint32_t r = rnd();
+        display->draw_circle(r & 0x7E, (r & 0x7E00) >> 8, (r & 0xF0000) >> 15, WHITE).refresh();
+
+        r = rnd();
+        display->fill_circle(r & 0x7E, (r & 0x7E00) >> 8, (r & 0xF0000) >> 16, INVERT).refresh();
+    }
+}
+
+static void lines()
+{
+    const uint8_t x{35}, y{60}, xx{97}, yy{23};
+
+    display->clear();
+    display->draw_line(85, 16, 103, 58, WHITE);
+    display->draw_line(3, 36, 14, 47, WHITE);
+    display->draw_line(20, 20, 55, 55, WHITE);
+    display->draw_line(22, 45, 115, 55, WHITE);
+    display->draw_line(0, 0, 127, 63, WHITE);
+    display->draw_line(127, 0, 0, 63, WHITE);
+    display->draw_line(40, 60, 17, 57, WHITE).refresh();
+
+    uint32_t r{rnd()};
+
+    int i{50}, j{std::max(static_cast<int>(r & 0x3), 1)}, //
+        k{std::max(static_cast<int>((r & 0xc) >> 2), 4)},  //
+        l{std::max(static_cast<int>((r & 0x30) >> 4), 2)}, //
+        m{std::min(static_cast<int>((r & 0xc0) >> 6) * -1, -2)};
+
+    r = rnd();
+
+    int jj{std::max(static_cast<int>(r & 0x3), 1)},         //
+        kk{std::max(static_cast<int>((r & 0xc) >> 2), 4)},  //
+        ll{std::max(static_cast<int>((r & 0x30) >> 4), 2)}, //
+        mm{std::min(static_cast<int>((r & 0xc0) >> 6) * -1, -2)};
+
+    uint8_t n{35}, o{60}, p{97}, q{23};
+    uint8_t s1{44}, s2{35}, t{66}, u{54};
+
+    while (i-- > 0)
+    {
+        display->clear(true).draw_line(n, o, p, q, WHITE).draw_line(s1, s2, t, u, INVERT).refresh();
+
+        n += j;
+        o += k;
+        p += l;
+        q += m;
+
+        if (n <= x || n >= xx)
+            j = -j;
+        if (p <= x || p >= xx)
+            l = -l;
+        if (o <= y || o >= yy)
+            k = -k;
+        if (q <= y || q >= yy)
+            m = -m;
+
+        s1 += jj;
+        s2 += kk;
+        t += ll;
+        u += mm;
+
+        if (s1 <= x || s1 >= xx)
+            jj = -jj;
+        if (s2 <= x || s2 >= xx)
+            ll = -ll;
+        if (t <= y || t >= yy)
+            kk = -kk;
+        if (u <= y || u >= yy)
+            mm = -mm;
+    }
+}
+
+static void font(uint8_t i)
+{
+    display->select_font(i).clear();
+    display->draw_string(0, 0, display->font_name(), WHITE, BLACK);
+    int y{0};
+    do
+    {
+        y = y + display->font_height();
+        display->draw_string(y, y, "ESP32-SSD1306-Driver", WHITE, BLACK);
+    } while (y < display->height());
+    display->refresh();
+}
+
+static void vertical()
+{
+    display->select_font(1).clear();
+    display->draw_string_vertical(0, 0, "Volts", WHITE, BLACK);
+    display->draw_string_vertical(20, 5, "ESP32-SSD1306", WHITE, BLACK);
+    display->select_font(0);
+    display->draw_string_vertical(60, 13, "Axis label", WHITE, BLACK);
+    display->draw_string(70, 0, "Across", WHITE, BLACK);
+    display->fill_rectangle(100, 0, 28, 64, WHITE);
+    display->draw_string_vertical(108, 30, "Dark", BLACK, WHITE);
+    display->refresh();
+}
+
+static void opaque()
+{
+    display->select_font(0).clear();
+    for (uint8_t x = 0; x < display->width(); x += 3)
+    {
+        display->draw_line(x, 0, x + 20, 63, WHITE);
+    }
+    display->draw_string(2, 3, "Opaque 12:34", WHITE, BLACK);
+    display->draw_string(2, 13, "Clear", WHITE, TRANSPARENT);
+    display->draw_string(40, 13, "Inverse", BLACK, WHITE);
+    uint8_t x{2}, w;
+    for (const char *c = "Chars"; *c; c++)
+    {
+        display->draw_char(x, 29, *c, WHITE, BLACK, &w);
+        x += w + display->font_c();
+    }
+    display->draw_string(50, 29, "Flip", WHITE, INVERT);
+    display->select_font(1);
+    display->draw_string_vertical(110, 10, "Side", WHITE, BLACK);
+    display->select_font(9);
+    display->draw_string(2, 45, "-273.15", WHITE, BLACK);
+    display->refresh();
+}
+
+static void numbers()
+{
+    Numeric_Field clock(0, 0, 9, 6, 0, true);
+    Numeric_Field temperature(0, 20, 0, 6, 2);
+    Numeric_Field counter(64, 20, 1, 5, 0, false, BLACK);
+    Numeric_Field overflow(64, 36, 0, 3);
+
+    display->clear();
+    display->fill_rectangle(60, 16, 68, 16, WHITE);
+    for (int32_t tick = 235950; tick <= 235959; tick++)
+    {
+        display->draw_number(clock, tick);
+    }
+    display->draw_number(temperature, 2731);
+    display->draw_number(temperature, -1515);
+    display->draw_number(counter, 999);
+    display->draw_number(counter, 1000);
+    display->draw_number(overflow, 1234);
+    display->draw_line(0, 63, 127, 48, WHITE);
+    display->draw_field(temperature);
+    display->refresh();
+}
+
+static void scaled()
+{
+    display->select_font(0).clear();
+    display->draw_string_scaled(0, 0, "2x", 2, WHITE, BLACK);
+    display->draw_string_scaled(30, 3, "3x", 3, WHITE, BLACK);
+    display->draw_string_scaled(70, 0, "4x", 4, WHITE, BLACK);
+    display->fill_rectangle(0, 30, 64, 34, WHITE);
+    display->select_font(1);
+    display->draw_string_scaled(2, 37, "12:45", 3, BLACK, WHITE);
+    display->draw_string_scaled(70, 45, "-7.5", 2, WHITE, TRANSPARENT);
+    display->refresh();
+}
+
+static void styles()
+{
+    display->select_font(14).clear();
+    display->draw_string(0, 0, "Normal", WHITE, BLACK);
+    display->select_style(STYLE_BOLD);
+    display->draw_string(64, 0, "Bold", WHITE, BLACK);
+    display->select_style(STYLE_UNDERLINE);
+    display->draw_string(0, 17, "Under", WHITE, BLACK);
+    display->select_style(STYLE_STRIKE);
+    display->draw_string(64, 17, "Strike", WHITE, BLACK);
+    display->select_style(STYLE_INVERSE);
+    display->draw_string(0, 35, "Inverse", WHITE, BLACK);
+    display->select_style(STYLE_BOLD);
+    display->select_font(7);
+    display->draw_string(0, 52, "Bold clear", WHITE, TRANSPARENT);
+    display->select_style(STYLE_BOLD | STYLE_UNDERLINE);
+    display->select_font(0);
+    display->draw_string_scaled(70, 37, "B+U", 2, WHITE, BLACK);
+    display->select_style(STYLE_NORMAL);
+    display->refresh();
+}
+
+/**
+ * @brief A 1024x512 virtual screen, its buffer past 64 KiB, drawn to its far corner and viewed there
+ */
+static void virtual_screen()
+{
+    Canvas screen(1024, 512);
+    Font_Manager font(0, Font_Manager::TBLR);
+
+    screen.box(0, 0, WHITE, 8, 8);
+    screen.horizontal(896, 448, WHITE, 128);
+    screen.vertical(896, 448, WHITE, 64);
+    screen.line(896, 511, WHITE, 1023, 448);
+    screen.text(900, 452, font, "1023,511", WHITE);
+    screen.box(1016, 504, WHITE, 8, 8);
+
+    display->clear();
+    display->viewport(screen, 896, 448).refresh();
+}
+
+static void layout()
+{
+    display->select_font(0).clear();
+    display->draw_rectangle(0, 0, 64, 40, WHITE);
+    display->draw_text(2, 2, 60, 36, "The quick brown fox jumps over the lazy dog", WHITE, BLACK, ALIGN_LEFT,
+                       LAYOUT_WRAP | LAYOUT_ELLIPSIS);
+    display->draw_text(66, 0, 62, 24, "Centered\nlines", WHITE, BLACK, ALIGN_CENTER);
+    display->draw_text(66, 24, 62, 16, "Right", BLACK, WHITE, ALIGN_RIGHT);
+    display->draw_text(0, 44, 128, 8, "Clipped at the right of the box with an ellipsis", WHITE, BLACK, ALIGN_LEFT,
+                       LAYOUT_ELLIPSIS);
+    display->draw_text(0, 54, 128, 10, "Extraordinarily-long-words break", WHITE, BLACK, ALIGN_LEFT);
+    display->refresh();
+}
+
+static void fit()
+{
+    static const uint8_t boxes[][4] = {{0, 0, 128, 34}, {0, 36, 70, 28}, {72, 36, 56, 16}, {72, 54, 56, 10}};
+
+    display->clear();
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        const uint8_t *box = boxes[i];
+        display->draw_rectangle(box[0], box[1], box[2], box[3], WHITE);
+        display->fit_font("21.5C", box[2] - 2, box[3] - 2);
+        display->draw_string(box[0] + 1, box[1] + 1, "21.5C", WHITE, BLACK);
+    }
+    display->refresh();
+}
+
+/**
+ * @brief Render a scene and check the panel against its golden
+ *
+ * @param name the scene name, also its golden file name
+ * @param draw draws the scene
+ * @return true if the panel matches the golden, or the golden was written
+ */
+template <typename F>
+static bool scene(const char *name, F draw)
+{
+    if (filter && !strstr(name, filter))
+        return true;
+
+    seed = 2463534242;
+    draw();
+    if (trace)
+        trace->frame();
+
+    std::vector<uint8_t> frame(WIDTH * (HEIGHT / 8));
+    pif.frame(frame.data(), WIDTH, HEIGHT);
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.pbm", golden_dir, name);
+
+    if (update)
+    {
+        if (!PBM::write(path, WIDTH, HEIGHT, frame.data()))
+        {
+            printf("%-36s cannot write %s\n", name, path);
+            return false;
+        }
+        printf("%-36s updated\n", name);
+        return true;
+    }
+
+    uint16_t width, height;
+    std::vector<uint8_t> golden;
+    if (!PBM::read(path, width, height, golden) || width != WIDTH || height != HEIGHT)
+    {
+        printf("%-36s FAIL no golden %s\n", name, path);
+        return false;
+    }
+
+    uint32_t differ{0};
+    std::vector<uint8_t> diff(frame.size());
+    for (size_t i = 0; i < frame.size(); i++)
+    {
+        diff[i] = frame[i] ^ golden[i];
+        differ += __builtin_popcount(diff[i]);
+    }
+
+    if (differ == 0)
+    {
+        printf("%-36s ok\n", name);
+        return true;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s.actual.pbm", out_dir, name);
+    PBM::write(path, WIDTH, HEIGHT, frame.data());
+    snprintf(path, sizeof(path), "%s/%s.diff.pbm", out_dir, name);
+    PBM::write(path, WIDTH, HEIGHT, diff.data());
+    printf("%-36s FAIL %d pixels differ, see %s\n", name, differ, path);
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--update"))
+            update = true;
+        else if (!strcmp(argv[i], "--golden") && i + 1 < argc)
+            golden_dir = argv[++i];
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+            out_dir = argv[++i];
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            trace_path = argv[++i];
+        else
+            filter = argv[i];
+    }
+
+    FILE *trace_file{nullptr};
+    if (trace_path)
+    {
+        trace_file = fopen(trace_path, "wb");
+        if (trace_file == nullptr)
+        {
+            printf("cannot write %s\n", trace_path);
+            return 1;
+        }
+        trace = new Trace_PIF(&pif, trace_file);
+    }
+
+    panel = new SSD1306_Panel<WIDTH, HEIGHT>(trace ? static_cast<PIF *>(trace) : &pif);
+    display = new OLED(*panel);
+    panel->init();
+
+    int failed{0};
+    failed += !scene("rectangle", rectangle);
+    failed += !scene("lines", lines);
+    failed += !scene("circles", circles);
+    failed += !scene("vertical", vertical);
+    failed += !scene("opaque", opaque);
+    failed += !scene("numbers", numbers);
+    failed += !scene("scaled", scaled);
+    failed += !scene("styles", styles);
+    failed += !scene("layout", layout);
+    failed += !scene("fit", fit);
+    failed += !scene("virtual", virtual_screen);
+
+    char name[64];
+    for (uint8_t i = 0; i < Font_Manager::fontcount(); i++)
+    {
+        display->select_font(i);
+        snprintf(name, sizeof(name), "font_%s", display->font_name());
+        failed += !scene(name, [i] { font(i); });
+    }
+
+    if (failed)
+        printf("%d scenes failed\n", failed);
+
+    delete display;
+    delete panel;
+    if (trace)
+    {
+        delete trace;
+        fclose(trace_file);
+    }
+    return failed;
+}
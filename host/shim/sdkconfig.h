@@ -0,0 +1,24 @@
+/*
+ ESP32-SSD1306-Driver Library host shim
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_HOST_SDKCONFIG_H_
+#define SSD1306_HOST_SDKCONFIG_H_
+
+/*
+ * Host builds take their configuration from the compiler definitions set in host/CMakeLists.txt
+ */
+
+#endif /* SSD1306_HOST_SDKCONFIG_H_ */
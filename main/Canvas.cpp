@@ -0,0 +1,1001 @@
+/*
+ ESP32-SSD1306-Driver Library Canvas
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "Canvas.h"
+#include "Stats.h"
+
+using std::max;
+using std::min;
+
+/**
+ * @brief Each bit of a nibble repeated 2, 3 and 4 times, for scaled text
+ */
+static const uint16_t SPREAD[3][16] = {
+    {0x0000, 0x0003, 0x000c, 0x000f, 0x0030, 0x0033, 0x003c, 0x003f, 0x00c0, 0x00c3, 0x00cc, 0x00cf, 0x00f0, 0x00f3,
+     0x00fc, 0x00ff},
+    {0x0000, 0x0007, 0x0038, 0x003f, 0x01c0, 0x01c7, 0x01f8, 0x01ff, 0x0e00, 0x0e07, 0x0e38, 0x0e3f, 0x0fc0, 0x0fc7,
+     0x0ff8, 0x0fff},
+    {0x0000, 0x000f, 0x00f0, 0x00ff, 0x0f00, 0x0f0f, 0x0ff0, 0x0fff, 0xf000, 0xf00f, 0xf0f0, 0xf0ff, 0xff00, 0xff0f,
+     0xfff0, 0xffff},
+};
+
+/**
+ * @brief Spread the bits of a segment, each repeated scale times
+ *
+ * @param bits the segment
+ * @param scale 2 to 4
+ * @return the spread bits, the low 8 x scale
+ */
+static inline uint32_t spread(uint8_t bits, uint8_t scale)
+{
+    const uint16_t *nibbles = SPREAD[scale - 2];
+    return nibbles[bits & 0x0F] | (uint32_t)nibbles[bits >> 4] << (4 * scale);
+}
+
+/**
+ * @brief Construct a new Canvas with its own buffer
+ *
+ * @param width canvas width in pixels
+ * @param height canvas height in pixels, at most MAX_HEIGHT
+ */
+Canvas::Canvas(uint16_t width, uint16_t height)
+    : m_owner{true}, m_width{width}, m_height{min(height, (uint16_t)MAX_HEIGHT)},
+      m_pages{static_cast<uint8_t>((m_height + 7) / 8)}
+{
+    if (height > MAX_HEIGHT)
+        ESP_LOGE(TAG, "Canvas height %d cut to %d", height, m_height);
+    m_buffer_bytes = (uint32_t)m_pages * m_width;
+    m_buffer = new uint8_t[m_buffer_bytes](); // Page by Column
+    ESP_LOGD(TAG, "Canvas %dx%d buffer size: %u buffer at %p", m_width, m_height, (unsigned)m_buffer_bytes, m_buffer);
+}
+
+/**
+ * @brief Construct a new Canvas over a provided buffer
+ *
+ * @param buffer page-packed buffer of at least width * height / 8 bytes
+ * @param width canvas width in pixels
+ * @param height canvas height in pixels, at most MAX_HEIGHT
+ */
+Canvas::Canvas(uint8_t *buffer, uint16_t width, uint16_t height)
+    : m_buffer{buffer}, m_owner{false}, m_width{width}, m_height{min(height, (uint16_t)MAX_HEIGHT)},
+      m_pages{static_cast<uint8_t>((m_height + 7) / 8)}
+{
+    if (height > MAX_HEIGHT)
+        ESP_LOGE(TAG, "Canvas height %d cut to %d", height, m_height);
+    m_buffer_bytes = (uint32_t)m_pages * m_width;
+}
+
+Canvas::~Canvas()
+{
+    if (m_owner)
+        delete[] m_buffer;
+}
+
+/**
+ * @brief   Return canvas width
+ * @return  Width in pixels
+ */
+uint16_t Canvas::width()
+{
+    return m_width;
+}
+
+/**
+ * @brief   Return canvas height
+ * @return  Height in pixels
+ */
+uint16_t Canvas::height()
+{
+    return m_height;
+}
+
+/**
+ * @brief   Return the canvas buffer
+ * @return  The page-packed buffer
+ */
+uint8_t *Canvas::buffer()
+{
+    return m_buffer;
+}
+
+/**
+ * @brief   The canvas as a page format image, for compositing onto another canvas
+ * @return  Image over the canvas buffer
+ */
+image_t Canvas::image()
+{
+    return image_t{m_width, m_height, IMAGE_TBLR, m_buffer, nullptr};
+}
+
+/**
+ * @brief   Clear the canvas (fill with black)
+ */
+void Canvas::clear()
+{
+    STATS_RASTER(buffer);
+
+    memset(m_buffer, 0, m_buffer_bytes);
+    touch();
+}
+
+/**
+ * @brief   Draw segment bits into one or more consecutive columns of a page
+ *
+ * @param   page    the page coord of the column
+ * @param   column  the column # in the page
+ * @param   bits    the segment bits to set
+ * @param   color   the color to set the segment bits
+ * @param   count   the number of consecutive segments in the page to draw
+ * @return  True if segment was drawn
+ */
+bool Canvas::segment(uint8_t page, uint16_t column, uint8_t bits, color_t color, uint16_t count)
+{
+    if (count == 0 || (page >= m_pages) || (column >= m_width))
+        return false;
+
+    uint16_t stopbeforecolumn = min<uint16_t>(column + count, m_width);
+
+    for (uint16_t i = column; i < stopbeforecolumn; i++)
+    {
+        write(page, i, bits, color);
+    }
+
+    m_dirtywindow.touch(page, column, stopbeforecolumn - 1);
+
+    return true;
+}
+
+/**
+ * @brief	Set the color of a single pixel
+ * @param   x   the x coord of the pixel
+ * @param   y   the y coord of the pixel
+ * @param   color   the desired color of the pixel
+ * @return  True if pixel was drawn
+ */
+bool Canvas::pixel(uint16_t x, uint16_t y, color_t color)
+{
+    if (y >= m_height)
+        return false;
+    return segment(y / 8, x, (1 << (y & 7)), color);
+}
+
+/**
+ * @brief	Draw a filled box of the given color
+ * @param   x   the starting x coord of the box
+ * @param   y   the starting y coord of the box
+ * @param   color   the color to set the box
+ * @param   w   the width of the box in pixels to draw
+ * @param   h   the height of the box in pixels
+ * @return  True if box was drawn
+ */
+bool Canvas::box(uint16_t x, uint16_t y, color_t color, uint16_t w, uint16_t h)
+{
+    ESP_LOGD(TAG, "box - x:%d y:%d w:%d h:%d", x, y, w, h);
+
+    if (w == 0 || h == 0 || x >= m_width || y >= m_height)
+        return false;
+
+    w = min<uint16_t>(w, m_width - x);  // Clip X
+    h = min<uint16_t>(h, m_height - y); // Clip Y
+
+    uint8_t pagestart = y / 8;
+    uint8_t pageend = (y + h - 1) / 8; // Do not double count origin line
+
+    uint8_t seg = y % 8;          // Start segment
+    uint8_t yremainder = 8 - seg; // Number of bits to draw
+    uint8_t filler = BITS[min<uint16_t>(yremainder, h) - 1] << seg;
+
+    /*
+     * First page
+     */
+    segment(pagestart, x, filler, color, w);
+
+    for (uint8_t p = (pagestart + 1); p < (pageend); p++)
+    /*
+     * Fill intermediate pages, if more than two pages
+     */
+    {
+        segment(p, x, 0xFF, color, w);
+    }
+
+    /*
+     * Last page, if multiple pages
+     */
+    if (pageend > pagestart)
+    {
+        seg = (y + h - 1) % 8; // Number of bits to draw
+        filler = BITS[seg];    // Get bit pattern a
+        segment(pageend, x, filler, color, w);
+    }
+    return true;
+}
+
+/**
+ * @brief	Draw a horizontal line of the given color
+ * @param   x   the starting x coord of the line
+ * @param   y   the starting y coord of the line
+ * @param   color   the color to set the segment bits
+ * @param   w   the width of the line in pixels to draw
+ * @param   h   the height of the line in pixels, defaults to 1
+ * @return  True if line was drawn
+ */
+bool Canvas::horizontal(uint16_t x, uint16_t y, color_t color, uint16_t w, uint16_t h)
+{
+    return box(x, y, color, w, h);
+}
+
+/**
+ * @brief	Draw a vertical line of the given color
+ * @param   x   the starting x coord of the line
+ * @param   y   the starting y coord of the line
+ * @param   color   the color to set the segment bits
+ * @param   h   the height of the line in pixels to draw
+ * @param   w   the width of the line in pixels, defaults to 1
+ * @return  True if line was drawn
+ */
+bool Canvas::vertical(uint16_t x, uint16_t y, color_t color, uint16_t h, uint16_t w)
+{
+    return box(x, y, color, w, h);
+}
+
+/**
+ * @brief   Draw an aliased line
+ *
+ * Any octant is handled; pixels falling in the same page of the same column are gathered into a
+ * single segment mask, and the dirty window is touched once for the whole line.
+ *
+ * @param   x       X coordinate or starting (top) point
+ * @param   y       Y coordinate or starting (top) point
+ * @param   color   Color of the line
+ * @param   xx      X coordinate or ending (bottom) point
+ * @param   yy      Y coordinate or ending (bottom) point
+ */
+void Canvas::line(uint16_t x, uint16_t y, color_t color, uint16_t xx, uint16_t yy)
+{
+    ESP_LOGD(TAG, "line - %d,%d - %d,%d", x, y, xx, yy);
+
+    dirtywindow extent;
+    stroke(x, y, xx, yy, color, false, extent);
+    touch(extent);
+}
+
+/**
+ * @brief   Draw connected line segments through a set of points
+ *
+ * Joining points are drawn once only, so INVERT polylines do not cancel out at the vertices.
+ *
+ * @param   xs      X coordinates of the points
+ * @param   ys      Y coordinates of the points
+ * @param   count   Number of points
+ * @param   color   Color of the lines
+ */
+void Canvas::polyline(const uint8_t *xs, const uint8_t *ys, uint8_t count, color_t color)
+{
+    ESP_LOGD(TAG, "polyline - count:%d", count);
+
+    if (count == 0)
+        return;
+
+    dirtywindow extent;
+    stroke(xs[0], ys[0], xs[0], ys[0], color, false, extent);
+    for (uint8_t i = 1; i < count; i++)
+    {
+        stroke(xs[i - 1], ys[i - 1], xs[i], ys[i], color, true, extent);
+    }
+    touch(extent);
+}
+
+/**
+ * @brief   Draw a sparkline, a polyline with one point per column
+ *
+ * @param   x       X coordinate of the first point, subsequent points are on consecutive columns
+ * @param   ys      Y coordinates of the points
+ * @param   count   Number of points
+ * @param   color   Color of the lines
+ */
+void Canvas::sparkline(uint16_t x, const uint8_t *ys, uint8_t count, color_t color)
+{
+    ESP_LOGD(TAG, "sparkline - x:%d count:%d", x, count);
+
+    if (count == 0)
+        return;
+
+    dirtywindow extent;
+    stroke(x, ys[0], x, ys[0], color, false, extent);
+    for (uint8_t i = 1; i < count; i++)
+    {
+        stroke(x + i - 1, ys[i - 1], x + i, ys[i], color, true, extent);
+    }
+    touch(extent);
+}
+
+/**
+ * @brief   Draw an image at the given position, clipped to the canvas
+ *
+ * Page format images placed on a page boundary are written a byte at a time; otherwise each image
+ * byte is shifted across the two pages it straddles. Row format images are gathered into page
+ * bytes on the fly.
+ *
+ * @param   x       the x coord of the image left, may be negative
+ * @param   y       the y coord of the image top, may be negative
+ * @param   image   the image
+ * @param   rop     how the image is combined with the buffer
+ * @return  True if any of the image was drawn
+ */
+bool Canvas::blit(int16_t x, int16_t y, const image_t &image, rop_t rop)
+{
+    STATS_RASTER(buffer);
+
+    ESP_LOGD(TAG, "blit - x:%d y:%d w:%d h:%d rop:%d", x, y, image.width, image.height, rop);
+
+    if (image.bitmap == nullptr || image.width == 0 || image.height == 0)
+        return false;
+
+    int32_t columnstart = max<int32_t>(0, -x);
+    int32_t columnend = min<int32_t>(image.width, m_width - x); // Stop before
+    if (columnstart >= columnend || y >= m_height || y + image.height <= 0)
+        return false;
+
+    uint16_t pages = (image.height + 7) / 8;
+    uint8_t shift = y & 7;                // Two's complement, so also right for negative y
+    int16_t pageorigin = (y - shift) / 8; // Floor of y / 8
+    dirtywindow extent;
+
+    for (uint16_t page = 0; page < pages; page++)
+    {
+        int16_t upper = pageorigin + page; // Page receiving the top of the image page
+        int16_t lower = upper + 1;         // Page receiving the bottom, when shifted
+        if (upper < 0 && (shift == 0 || lower < 0))
+            continue;
+        if (upper >= m_pages)
+            break;
+
+        uint8_t rows = (page == pages - 1 && (image.height & 7)) ? BITS[(image.height & 7) - 1] : 0xFF;
+
+        for (int32_t column = columnstart; column < columnend; column++)
+        {
+            uint8_t bits = fetch(image, image.bitmap, page, column);
+            uint8_t mask = rows;
+            if (image.mask)
+                mask &= fetch(image, image.mask, page, column);
+
+            uint16_t col = x + column;
+
+            if (shift == 0)
+            /*
+             * Page aligned, straight through
+             */
+            {
+                combine(upper, col, bits, mask, rop);
+                continue;
+            }
+
+            if (upper >= 0)
+                combine(upper, col, bits << shift, mask << shift, rop);
+            if (lower < m_pages)
+                combine(lower, col, bits >> (8 - shift), mask >> (8 - shift), rop);
+        }
+
+        if (upper >= 0)
+            extent.touch(upper, x + columnstart, x + columnend - 1);
+        if (shift && lower < m_pages)
+            extent.touch(lower, x + columnstart, x + columnend - 1);
+    }
+
+    touch(extent);
+    return extent.isdirty;
+}
+
+/**
+ * @brief   Scroll the content of an area left, clearing the vacated columns
+ *
+ * Bits outside the area on partially covered pages are preserved.
+ *
+ * @param   x   the starting x coord of the area
+ * @param   y   the starting y coord of the area
+ * @param   w   the width of the area in pixels
+ * @param   h   the height of the area in pixels
+ * @param   n   the number of columns to scroll by
+ * @return  True if the area was scrolled
+ */
+bool Canvas::scroll(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t n)
+{
+    STATS_RASTER(buffer);
+
+    ESP_LOGD(TAG, "scroll - x:%d y:%d w:%d h:%d n:%d", x, y, w, h, n);
+
+    if (w == 0 || h == 0 || n == 0 || x >= m_width || y >= m_height)
+        return false;
+
+    w = min<uint16_t>(w, m_width - x);  // Clip X
+    h = min<uint16_t>(h, m_height - y); // Clip Y
+    n = min(n, w);
+
+    uint8_t pagestart = y / 8;
+    uint8_t pageend = (y + h - 1) / 8;
+    uint16_t columnend = x + w - 1;
+
+    for (uint16_t page = pagestart; page <= pageend; page++)
+    {
+        uint8_t mask{0xFF};
+        if (page == pagestart)
+            mask &= 0xFF << (y % 8);
+        if (page == pageend)
+            mask &= BITS[(y + h - 1) % 8];
+
+        uint8_t *data = row(page);
+        uint16_t column = x;
+
+        if (mask == 0xFF)
+        /*
+         * Whole page bytes, move them wholesale
+         */
+        {
+            memmove(data + x, data + x + n, w - n);
+            memset(data + columnend + 1 - n, 0, n);
+        }
+        else
+        {
+            for (; column + n <= columnend; column++)
+            {
+                data[column] = (data[column] & ~mask) | (data[column + n] & mask);
+            }
+            for (; column <= columnend; column++)
+            {
+                data[column] &= ~mask;
+            }
+        }
+        m_dirtywindow.touch(page, x, columnend);
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Draw a string in the given font
+ *
+ * @param   x           X position of string (top-left corner)
+ * @param   y           Y position of string (top-left corner)
+ * @param   font        The font to rasterize with, in TBLR raster mode
+ * @param   str         The string to draw
+ * @param   color       Character color
+ * @param   background  Background color of the string box, gaps included, or TRANSPARENT
+ * @param   style       Text style flags
+ * @return  Width of the string (out-of-canvas pixels also included)
+ */
+uint16_t Canvas::text(uint16_t x, uint16_t y, Font_Manager &font, const std::string &str, color_t color,
+                      color_t background, uint8_t style)
+{
+    return text(x, y, font, str.data(), str.length(), color, background, style);
+}
+
+/**
+ * @brief   Draw part of a string in the given font, without copying it
+ *
+ * @param   x           X position of string (top-left corner)
+ * @param   y           Y position of string (top-left corner)
+ * @param   font        The font to rasterize with, in TBLR raster mode
+ * @param   str         The first character to draw
+ * @param   length      The number of characters
+ * @param   color       Character color
+ * @param   background  Background color of the string box, gaps included, or TRANSPARENT
+ * @param   style       Text style flags
+ * @return  Width of the characters (out-of-canvas pixels also included)
+ */
+uint16_t Canvas::text(uint16_t x, uint16_t y, Font_Manager &font, const char *str, uint16_t length, color_t color,
+                      color_t background, uint8_t style)
+{
+    STATS_RASTER(buffer);
+    STATS_ADD(glyphs, length);
+
+    if (length == 0)
+        return 0;
+
+    Font_Manager::bitmap scan = font.rasterize(str, length, y);
+    return place(x, y, scan, color, background, style);
+}
+
+/**
+ * @brief   Draw a character in the given font
+ *
+ * @param   x           X position of character (top-left corner)
+ * @param   y           Y position of character (top-left corner)
+ * @param   font        The font to rasterize with, in TBLR raster mode
+ * @param   c           The character to draw
+ * @param   color       Character color
+ * @param   background  Background color of the character box and the gap after it, or TRANSPARENT
+ * @param   style       Text style flags
+ * @return  Width of the character
+ */
+uint16_t Canvas::text(uint16_t x, uint16_t y, Font_Manager &font, unsigned char c, color_t color,
+                      color_t background, uint8_t style)
+{
+    STATS_RASTER(buffer);
+    STATS_ADD(glyphs, 1);
+
+    if (c == 0)
+        return 0;
+
+    Font_Manager::bitmap scan = font.rasterize(c, y);
+    return place(x, y, scan, color, background, style, font.font_c());
+}
+
+/**
+ * @brief   Draw a string turned a quarter anticlockwise, reading upwards, in the given font
+ *
+ * A row scanned raster is, byte for byte, the page segments of the turned text: each scan line
+ * is a column, its leftmost pixel at the bottom. The raster is offset so its bytes fall on the
+ * page boundaries and is written straight into the pages, with no transposing of bits.
+ *
+ * @param   x       X position of the text (left, the top of the characters)
+ * @param   y       Y position of the text (top, the end of the string)
+ * @param   font    The font to rasterize with, in LRTB raster mode
+ * @param   str         The string to draw
+ * @param   color       Text color
+ * @param   background  Background color of the text box, gaps included, or TRANSPARENT
+ * @return  Height of the text
+ */
+uint16_t Canvas::text_vertical(uint16_t x, uint16_t y, Font_Manager &font, const std::string &str, color_t color,
+                               color_t background)
+{
+    STATS_RASTER(buffer);
+    STATS_ADD(glyphs, str.length());
+
+    uint16_t height = font.measure_string(str);
+    if (height == 0 || x >= m_width)
+        return height;
+
+    uint16_t bottom = y + height - 1; // Row of the first character's left edge
+    Font_Manager::bitmap scan = font.rasterize(str, 7 - bottom % 8);
+    uint16_t columnend = min<uint32_t>(x + scan.height_bytes, m_width); // Stop before
+    uint16_t pagebottom = bottom / 8;
+    uint16_t pagetop = pagebottom - min<uint16_t>(scan.width_bytes - 1, pagebottom);
+    if (pagetop >= m_pages)
+        return height;
+
+    ink foreground{color}, back{background};
+    uint8_t topmask = 0xFF << (y % 8);
+    uint8_t bottommask = BITS[bottom % 8];
+
+    const uint8_t *d = scan.data;
+    for (uint16_t column = x; column < columnend; column++, d += scan.width_bytes)
+    {
+        for (uint16_t page = pagetop; page <= pagebottom && page < m_pages; page++)
+        {
+            uint8_t mask = (page == pagetop ? topmask : 0xFF) & (page == pagebottom ? bottommask : 0xFF);
+            write(page, column, d[pagebottom - page], mask, foreground, back);
+        }
+    }
+
+    m_dirtywindow.touch(pagetop, min<uint16_t>(pagebottom, m_pages - 1), x, columnend - 1);
+    return height;
+}
+
+/**
+ * @brief   Draw a string magnified 2, 3 or 4 times in the given font
+ *
+ * The string is rasterized at the font's size, then each page byte of the raster is spread by
+ * nibble lookup into scale page bytes, shifted to the row, and written scale columns wide; big
+ * readouts come from small fonts with no per pixel work.
+ *
+ * @param   x           X position of string (top-left corner)
+ * @param   y           Y position of string (top-left corner)
+ * @param   font        The font to rasterize with, in TBLR raster mode
+ * @param   str         The string to draw
+ * @param   scale       Magnification, 2 to 4, 1 draws the font's size
+ * @param   color       Character color
+ * @param   background  Background color of the string box, gaps included, or TRANSPARENT
+ * @param   style       Text style flags, applied before magnifying
+ * @return  Width of the string (out-of-canvas pixels also included)
+ */
+uint16_t Canvas::text_scaled(uint16_t x, uint16_t y, Font_Manager &font, const std::string &str, uint8_t scale,
+                             color_t color, color_t background, uint8_t style)
+{
+    if (scale <= 1)
+        return text(x, y, font, str, color, background, style);
+
+    STATS_RASTER(buffer);
+    STATS_ADD(glyphs, str.length());
+
+    if (str.empty())
+        return 0;
+
+    scale = min<uint8_t>(scale, 4);
+    Font_Manager::bitmap scan = font.rasterize(str); // Page aligned, the spread bits are shifted
+    uint16_t columns = scan.width_bytes; // Raster columns drawn
+    if ((style & STYLE_BOLD) && !(style & STYLE_INVERSE))
+        columns++; // The emboldened last column spills past the text
+    uint16_t columnend = min<uint32_t>(x + columns * scale, m_width); // Stop before
+    uint8_t shift = y % 8;
+    uint8_t pages = scale + (shift ? 1 : 0); // Pages each raster page spreads across
+    ink foreground{color}, back{background};
+    dirtywindow extent;
+
+    for (uint16_t p = 0; p < scan.height_bytes; p++)
+    {
+        uint16_t pagetop = y / 8 + p * scale;
+        if (pagetop >= m_pages)
+            break;
+
+        uint8_t rows = p == scan.height_bytes - 1 ? BITS[(scan.bitheight - 1) % 8] : 0xFF;
+        uint64_t mask = (uint64_t)spread(rows, scale) << shift;
+        uint8_t line = lines(scan, p, style);
+        const uint8_t *d = scan.data + p * scan.width_bytes;
+
+        uint8_t pageend = min<uint16_t>(pagetop + pages, m_pages); // Stop before
+
+        for (uint16_t column = x, c = 0; column < columnend; c++)
+        {
+            uint8_t styledbits;
+            uint64_t bits, columnmask = mask;
+            if (c < scan.width_bytes)
+                styledbits = styled(d[c], c ? d[c - 1] : 0, line, rows, style);
+            else
+            /*
+             * The bold spill, only the stroke outside the text box
+             */
+            {
+                styledbits = d[c - 1] & rows;
+                columnmask = (uint64_t)spread(styledbits, scale) << shift;
+            }
+            bits = (uint64_t)spread(styledbits, scale) << shift;
+            uint16_t end = min<uint16_t>(column + scale, columnend);
+            for (; column < end; column++)
+            {
+                for (uint16_t page = pagetop; page < pageend; page++)
+                {
+                    uint8_t k = 8 * (page - pagetop);
+                    write(page, column, bits >> k, columnmask >> k, foreground, back);
+                }
+            }
+        }
+        if (columnend > x)
+        {
+            extent.touch(pagetop, pageend - 1, x, columnend - 1);
+        }
+    }
+
+    touch(extent);
+    return scan.bitwidth * scale;
+}
+
+/**
+ * @brief   Return the buffer row of a page
+ *
+ * @param   page    the page
+ * @return  The first column byte of the page
+ */
+uint8_t *Canvas::row(uint8_t page)
+{
+    return m_buffer + page * m_width;
+}
+
+/**
+ * @brief   Touch the entire canvas
+ */
+void Canvas::touch()
+{
+    m_dirtywindow.touch(0, m_pages - 1, 0, m_width - 1);
+}
+
+/**
+ * @brief   Merge a drawn extent into the dirty window
+ *
+ * @param   extent  the area drawn
+ */
+void Canvas::touch(const dirtywindow &extent)
+{
+    uint16_t colstart, colend;
+    for (uint16_t page = extent.toppage; page <= extent.bottompage; page++)
+    {
+        if (extent.span(page, colstart, colend))
+            m_dirtywindow.touch(page, colstart, colend);
+    }
+}
+
+/**
+ * @brief   Write segment bits into the buffer, no clipping nor dirty tracking
+ *
+ * @param   page    the page coord of the column
+ * @param   column  the column # in the page
+ * @param   bits    the segment bits to set
+ * @param   color   the color to set the segment bits
+ */
+inline void Canvas::write(uint8_t page, uint16_t column, uint8_t bits, color_t color)
+{
+    uint8_t &segment = m_buffer[page * m_width + column];
+
+    switch (color)
+    {
+    case WHITE:
+        segment |= bits;
+        break;
+    case BLACK:
+        segment &= ~bits;
+        break;
+    case INVERT:
+        segment ^= bits;
+        break;
+    default:
+        break;
+    } // switch
+}
+
+/**
+ * @brief   Write glyph bits and the background around them into the buffer in one store
+ *
+ * The foreground color applies to the set bits, the background color to the clear bits within the
+ * mask, and the bits outside the mask are kept, so partial pages above and below text keep what
+ * was drawn there. No clipping nor dirty tracking.
+ *
+ * @param   page        the page coord of the column
+ * @param   column      the column # in the page
+ * @param   bits        the glyph bits
+ * @param   mask        the bits of the segment covered by the text box
+ * @param   foreground  the glyph color
+ * @param   background  the background color
+ */
+inline void Canvas::write(uint8_t page, uint16_t column, uint8_t bits, uint8_t mask, const ink &foreground,
+                          const ink &background)
+{
+    uint8_t &segment = m_buffer[page * m_width + column];
+    uint8_t clear = mask & ~bits;
+
+    uint8_t on = (bits & foreground.on) | (clear & background.on);
+    uint8_t off = (bits & foreground.off) | (clear & background.off);
+    uint8_t flip = (bits & foreground.flip) | (clear & background.flip);
+    segment = ((segment & ~off) | on) ^ flip;
+}
+
+/**
+ * @brief   Bresenham line rasterizer, accumulating runs of pixels into segment masks
+ *
+ * Pixels outside the canvas are clipped. The touched area is accumulated into the extent rather than
+ * the dirty window so callers can update the dirty window once.
+ *
+ * @param   x           X coordinate of the starting point
+ * @param   y           Y coordinate of the starting point
+ * @param   xx          X coordinate of the ending point
+ * @param   yy          Y coordinate of the ending point
+ * @param   color       Color of the line
+ * @param   skipfirst   Do not draw the starting point (already drawn as a previous end point)
+ * @param   extent      Accumulated area drawn
+ */
+void Canvas::stroke(int x, int y, int xx, int yy, color_t color, bool skipfirst, dirtywindow &extent)
+{
+    int dx{xx > x ? xx - x : x - xx};
+    int dy{yy > y ? y - yy : yy - y}; // Negative
+    int xstep{x < xx ? 1 : -1};
+    int ystep{y < yy ? 1 : -1};
+    int err{dx + dy};
+
+    uint8_t page{0}, mask{0};
+    uint16_t column{0};
+
+    while (true)
+    {
+        if (skipfirst)
+            skipfirst = false;
+        else if (x >= 0 && x < m_width && y >= 0 && y < m_height)
+        {
+            if (mask && (column != x || page != (y >> 3)))
+            /*
+             * Moved off the current segment, write it out
+             */
+            {
+                write(page, column, mask, color);
+                extent.touch(page, column, column);
+                mask = 0;
+            }
+            page = y >> 3;
+            column = x;
+            mask |= 1 << (y & 7);
+        }
+
+        if (x == xx && y == yy)
+            break;
+
+        int e2{2 * err};
+        if (e2 >= dy)
+        {
+            err += dy;
+            x += xstep;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y += ystep;
+        }
+    }
+
+    if (mask)
+    {
+        write(page, column, mask, color);
+        extent.touch(page, column, column);
+    }
+}
+
+/**
+ * @brief   Combine masked bits into the buffer with a raster operation
+ *
+ * @param   page    the page coord of the column
+ * @param   column  the column # in the page
+ * @param   bits    the image bits
+ * @param   mask    the bits of the segment covered by the image
+ * @param   rop     how the image is combined with the buffer
+ */
+inline void Canvas::combine(uint8_t page, uint16_t column, uint8_t bits, uint8_t mask, rop_t rop)
+{
+    uint8_t &segment = m_buffer[page * m_width + column];
+
+    switch (rop)
+    {
+    case ROP_COPY:
+        segment = (segment & ~mask) | (bits & mask);
+        break;
+    case ROP_OR:
+        segment |= bits & mask;
+        break;
+    case ROP_AND:
+        segment &= bits | ~mask;
+        break;
+    case ROP_XOR:
+        segment ^= bits & mask;
+        break;
+    }
+}
+
+/**
+ * @brief   Read a page byte from an image plane
+ *
+ * @param   image   the image, giving the plane format and geometry
+ * @param   plane   the bitmap or mask plane
+ * @param   page    the image page
+ * @param   column  the image column
+ * @return  the 8 vertical pixels, LSB on top
+ */
+inline uint8_t Canvas::fetch(const image_t &image, const uint8_t *plane, uint16_t page, uint16_t column)
+{
+    if (image.format == IMAGE_TBLR)
+        return plane[page * image.width + column];
+
+    /*
+     * Row format, gather a bit from each of the 8 rows
+     */
+    uint16_t stride = (image.width + 7) / 8;
+    uint16_t row = page * 8;
+    uint8_t rows = min(8, image.height - row);
+    const uint8_t *data = plane + row * stride + column / 8;
+    uint8_t bit = 0x80 >> (column & 7);
+    uint8_t bits{0};
+
+    for (uint8_t r = 0; r < rows; r++, data += stride)
+    {
+        if (*data & bit)
+            bits |= 1 << r;
+    }
+    return bits;
+}
+
+/**
+ * @brief   Place a rasterized TBLR bitmap, clipped to the canvas
+ *
+ * An opaque background fills the bitmap's rows of each page, the partial top and bottom pages
+ * included, in the same write as the glyph bits.
+ *
+ * @param   x           X position of the bitmap
+ * @param   y           Y position of the bitmap, the bitmap carries the offset within the page
+ * @param   scan        The rasterized bitmap
+ * @param   color       Bitmap color
+ * @param   background  Background color, or TRANSPARENT
+ * @param   style       Text style flags
+ * @param   gap         Columns of background after the bitmap, for the gap after a character
+ * @return  Width of the bitmap
+ */
+uint16_t Canvas::place(uint16_t x, uint16_t y, Font_Manager::bitmap &scan, color_t color, color_t background,
+                       uint8_t style, uint8_t gap)
+{
+    uint8_t *d = scan.data;
+    uint16_t bitmapend = min<uint32_t>(x + scan.width_bytes, m_width); // Stop before
+    uint16_t boxend = background == TRANSPARENT ? bitmapend : min<uint32_t>(bitmapend + gap, m_width);
+    uint16_t columnend = boxend;
+    if ((style & STYLE_BOLD) && !(style & STYLE_INVERSE) && boxend == x + scan.width_bytes)
+        columnend = min<uint32_t>(boxend + 1, m_width); // The emboldened last column spills past the box
+    ink foreground{color}, back{background};
+    dirtywindow extent;
+
+    for (uint16_t p = 0; p < scan.height_bytes; p++, d += scan.width_bytes)
+    {
+        uint16_t page = (y / 8) + p;
+        if (page >= m_pages)
+            break;
+
+        uint8_t mask = p == 0 ? 0xFF << scan.bitheightoffset : 0xFF;
+        if (p == scan.height_bytes - 1)
+            mask &= BITS[(scan.bitheight - 1) % 8];
+
+        uint8_t line = lines(scan, p, style);
+        uint8_t previous{0};
+
+        uint16_t column = x;
+        for (; column < bitmapend; column++)
+        {
+            uint8_t bits = d[column - x];
+            write(page, column, styled(bits, previous, line, mask, style), mask, foreground, back);
+            previous = bits;
+        }
+        for (; column < boxend; column++)
+        {
+            write(page, column, styled(0, previous, line, mask, style), mask, foreground, back);
+            previous = 0;
+        }
+        if (column < columnend)
+        {
+            uint8_t spill = previous & mask; // Only the stroke, the column is outside the box
+            write(page, column, spill, spill, foreground, back);
+        }
+        if (columnend > x)
+        {
+            extent.touch(page, x, columnend - 1);
+        }
+    }
+
+    touch(extent);
+    return scan.bitwidth;
+}
+
+/**
+ * @brief   The underline and strike-through bits of a page of a rasterized TBLR bitmap
+ *
+ * @param   scan    The rasterized bitmap
+ * @param   page    The bitmap page
+ * @param   style   Text style flags
+ * @return  The line bits in the page
+ */
+uint8_t Canvas::lines(const Font_Manager::bitmap &scan, uint16_t page, uint8_t style)
+{
+    uint16_t bottom = scan.bitheight - 1;                                                  // Last font row
+    uint16_t middle = scan.bitheightoffset + (scan.bitheight - scan.bitheightoffset) / 2; // Middle font row
+    uint8_t bits{0};
+
+    if ((style & STYLE_UNDERLINE) && bottom / 8 == page)
+        bits |= 1 << (bottom % 8);
+    if ((style & STYLE_STRIKE) && middle / 8 == page)
+        bits |= 1 << (middle % 8);
+    return bits;
+}
+
+/**
+ * @brief   Apply the text style to a column of glyph bits
+ *
+ * @param   bits        the glyph bits
+ * @param   previous    the glyph bits of the column before, for bold
+ * @param   lines       the underline and strike-through bits
+ * @param   mask        the bits of the segment covered by the text box, for inverse
+ * @param   style       Text style flags
+ * @return  the styled bits
+ */
+inline uint8_t Canvas::styled(uint8_t bits, uint8_t previous, uint8_t lines, uint8_t mask, uint8_t style)
+{
+    if (style & STYLE_BOLD)
+        bits |= previous;
+    bits |= lines;
+    if (style & STYLE_INVERSE)
+        bits = ~bits & mask;
+    return bits;
+}
@@ -0,0 +1,262 @@
+/*
+ ESP32-SSD1306-Driver Library Chart
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "Chart.h"
+
+using std::max;
+using std::min;
+
+/**
+ * @brief Construct a new Chart object
+ *
+ * @param x plot area left
+ * @param y plot area top
+ * @param w plot area width, also the number of columns of history held
+ * @param h plot area height
+ * @param decimate number of samples combined into each column
+ * @param mode how samples are combined into a column
+ */
+Chart::Chart(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t decimate, Decimation mode)
+    : m_x{x}, m_y{y}, m_w{max(w, (uint8_t)1)}, m_h{max(h, (uint8_t)1)}, m_decimate{max(decimate, (uint8_t)1)},
+      m_mode{mode}
+{
+    m_lo = new int16_t[m_w];
+    m_hi = new int16_t[m_w];
+}
+
+Chart::~Chart()
+{
+    delete[] m_lo;
+    delete[] m_hi;
+}
+
+/**
+ * @brief Fix the plot range, turning off auto-scaling
+ *
+ * @param min value plotted at the bottom of the area
+ * @param max value plotted at the top of the area
+ */
+void Chart::range(int16_t min, int16_t max)
+{
+    m_autoscale = false;
+    m_min = min;
+    m_max = max;
+    m_rescaled = true;
+}
+
+/**
+ * @brief Scale the plot range to the min/max of the samples held
+ */
+void Chart::autoscale()
+{
+    m_autoscale = true;
+    m_rescaled |= rescale();
+}
+
+/**
+ * @brief Add a sample
+ *
+ * @param sample the sample value
+ * @return true if the sample completed a column, which should then be drawn with append()
+ */
+bool Chart::push(int16_t sample)
+{
+    if (m_accn == 0)
+    {
+        m_sum = 0;
+        m_acclo = sample;
+        m_acchi = sample;
+    }
+    m_sum += sample;
+    m_acclo = min(m_acclo, sample);
+    m_acchi = max(m_acchi, sample);
+
+    if (++m_accn < m_decimate)
+        return false;
+
+    /*
+     * Column complete, place it in the ring
+     */
+    uint8_t i;
+    if (m_count < m_w)
+    {
+        i = index(m_count++);
+    }
+    else
+    {
+        i = m_head;
+        m_head = index(1);
+    }
+
+    if (m_mode == AVERAGE)
+    {
+        m_lo[i] = m_hi[i] = m_sum / m_accn;
+    }
+    else
+    {
+        m_lo[i] = m_acclo;
+        m_hi[i] = m_acchi;
+    }
+    m_accn = 0;
+
+    if (m_autoscale)
+        m_rescaled |= rescale();
+
+    return true;
+}
+
+/**
+ * @brief Draw the latest column
+ *
+ * Once the plot is full the area is scrolled left a column to make room. Falls back to a full
+ * redraw if the range has changed.
+ *
+ * @param canvas the canvas to draw on
+ * @param color the plot color
+ */
+void Chart::append(Canvas &canvas, color_t color)
+{
+    if (m_count == 0)
+        return;
+
+    if (m_rescaled)
+    {
+        redraw(canvas, color);
+        return;
+    }
+
+    if (m_count == m_w)
+        canvas.scroll(m_x, m_y, m_w, m_h, 1);
+
+    draw(canvas, m_count - 1, color);
+}
+
+/**
+ * @brief Clear the plot area and draw all the held columns
+ *
+ * @param canvas the canvas to draw on
+ * @param color the plot color
+ */
+void Chart::redraw(Canvas &canvas, color_t color)
+{
+    canvas.box(m_x, m_y, BLACK, m_w, m_h);
+
+    for (uint8_t column = 0; column < m_count; column++)
+    {
+        draw(canvas, column, color);
+    }
+    m_rescaled = false;
+}
+
+/**
+ * @brief The number of columns held
+ *
+ * @return the column count
+ */
+uint8_t Chart::count()
+{
+    return m_count;
+}
+
+/**
+ * @brief Ring buffer index of a plotted column
+ *
+ * @param column the column, 0 being the oldest
+ * @return the ring buffer index
+ */
+uint8_t Chart::index(uint8_t column)
+{
+    return (m_head + column) % m_w;
+}
+
+/**
+ * @brief Recalculate the min/max of the held columns
+ *
+ * @return true if the range changed
+ */
+bool Chart::rescale()
+{
+    if (m_count == 0)
+        return false;
+
+    int16_t lo{m_lo[m_head]}, hi{m_hi[m_head]};
+    for (uint8_t column = 1; column < m_count; column++)
+    {
+        uint8_t i = index(column);
+        lo = min(lo, m_lo[i]);
+        hi = max(hi, m_hi[i]);
+    }
+
+    if (lo == m_min && hi == m_max)
+        return false;
+
+    m_min = lo;
+    m_max = hi;
+    return true;
+}
+
+/**
+ * @brief Scale a value to a y coordinate in the plot area
+ *
+ * @param value the value
+ * @return the y coordinate, clamped to the plot area
+ */
+uint8_t Chart::scale(int16_t value)
+{
+    if (m_max <= m_min)
+        return m_y + m_h / 2;
+
+    value = min(max(value, m_min), m_max);
+    return m_y + (m_h - 1) - ((int32_t)(value - m_min) * (m_h - 1)) / (m_max - m_min);
+}
+
+/**
+ * @brief Draw one column, joined to the column before it
+ *
+ * @param canvas the canvas to draw on
+ * @param column the column, 0 being the oldest
+ * @param color the plot color
+ */
+void Chart::draw(Canvas &canvas, uint8_t column, color_t color)
+{
+    uint8_t i = index(column);
+    uint8_t x = m_x + column;
+    uint8_t top = scale(m_hi[i]);
+    uint8_t bottom = scale(m_lo[i]);
+
+    if (column == 0)
+    {
+        canvas.vertical(x, top, color, 1 + bottom - top);
+        return;
+    }
+
+    uint8_t p = index(column - 1);
+
+    if (m_mode == AVERAGE)
+    {
+        canvas.line(x - 1, scale(m_lo[p]), color, x, bottom);
+        return;
+    }
+
+    /*
+     * Stretch the envelope to meet the previous column
+     */
+    top = min(top, scale(m_lo[p]));
+    bottom = max(bottom, scale(m_hi[p]));
+    canvas.vertical(x, top, color, 1 + bottom - top);
+}
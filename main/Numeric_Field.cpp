@@ -0,0 +1,224 @@
+/*
+ ESP32-SSD1306-Driver Library Numeric Field
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "Numeric_Field.h"
+
+using std::max;
+using std::min;
+
+static const char GLYPHS[] = "0123456789- "; ///< The cached glyphs, in cell order, the point follows
+static const uint8_t GLYPHCOUNT = sizeof(GLYPHS) - 1;
+
+/**
+ * @brief Construct a new Numeric Field object, rasterizing its glyphs
+ *
+ * @param x field left
+ * @param y field top
+ * @param font index of the font
+ * @param digits number of digit cells, the sign included
+ * @param decimals number of the digit cells after the decimal point, 0 for an integer field
+ * @param zeros pad with leading zeros rather than blanks
+ * @param color digit color, WHITE on BLACK, or BLACK on WHITE
+ */
+Numeric_Field::Numeric_Field(uint8_t x, uint8_t y, uint8_t font, uint8_t digits, uint8_t decimals, bool zeros,
+                             color_t color)
+    : m_x{x}, m_y{y}, m_digits{min(max(digits, (uint8_t)1), (uint8_t)CELLS)}, m_zeros{zeros}
+{
+    m_decimals = min(decimals, (uint8_t)(m_digits - 1));
+    memset(m_shown, 0, sizeof(m_shown));
+
+    Font_Manager manager(font, Font_Manager::TBLR);
+    m_height = manager.font_height();
+    m_pages = (m_height + 7) / 8;
+
+    /*
+     * Cells as wide as the widest glyph, so digits of proportional fonts stay put
+     */
+    m_cell = 0;
+    for (uint8_t g = 0; g < GLYPHCOUNT; g++)
+    {
+        m_cell = max<uint8_t>(m_cell, manager.measure_string(std::string(1, GLYPHS[g])));
+    }
+    m_point = m_decimals ? manager.measure_string(".") : 0;
+
+    m_glyphs = new uint8_t[(GLYPHCOUNT * m_cell + m_point) * m_pages]();
+
+    for (uint8_t g = 0; g <= GLYPHCOUNT; g++)
+    {
+        char c = g < GLYPHCOUNT ? GLYPHS[g] : '.';
+        uint8_t width = g < GLYPHCOUNT ? m_cell : m_point;
+        if (width == 0)
+            continue;
+
+        Font_Manager::bitmap scan = manager.rasterize(c);
+        uint8_t *cell = glyph(c);
+        uint8_t left = (width - manager.font_c() - scan.width_bytes) / 2; // Centered, the gap on the right
+
+        for (uint8_t page = 0; page < m_pages; page++)
+        {
+            if (scan.width_bytes)
+                memcpy(cell + page * width + left, scan.data + page * scan.width_bytes, scan.width_bytes);
+            if (color == BLACK)
+            {
+                for (uint8_t column = 0; column < width; column++)
+                {
+                    cell[page * width + column] ^= 0xFF;
+                }
+            }
+        }
+    }
+}
+
+Numeric_Field::~Numeric_Field()
+{
+    delete[] m_glyphs;
+}
+
+/**
+ * @brief Show a value, drawing the cells whose character changed
+ *
+ * The value is fixed-point, in units of the last decimal place: 2731 in a field of one decimal
+ * shows 273.1. A value too wide for the field shows as dashes.
+ *
+ * @param canvas the canvas to draw on
+ * @param value the value
+ * @return the number of cells drawn
+ */
+uint8_t Numeric_Field::update(Canvas &canvas, int32_t value)
+{
+    char text[CELLS];
+    format(value, text);
+    m_value = value;
+
+    if (m_point && m_shown[0] == 0)
+    {
+        image_t point{m_point, m_height, IMAGE_TBLR, glyph('.'), nullptr};
+        canvas.blit(m_x + (m_digits - m_decimals) * m_cell, m_y, point, ROP_COPY);
+    }
+
+    uint8_t drawn{0};
+    for (uint8_t cell = 0; cell < m_digits; cell++)
+    {
+        if (text[cell] == m_shown[cell])
+            continue;
+
+        draw(canvas, cell, text[cell]);
+        m_shown[cell] = text[cell];
+        drawn++;
+    }
+    return drawn;
+}
+
+/**
+ * @brief Draw the whole field, after the canvas has been cleared or drawn over
+ *
+ * @param canvas the canvas to draw on
+ */
+void Numeric_Field::redraw(Canvas &canvas)
+{
+    memset(m_shown, 0, sizeof(m_shown));
+    update(canvas, m_value);
+}
+
+/**
+ * @brief The field width
+ *
+ * @return the width in pixels
+ */
+uint16_t Numeric_Field::width()
+{
+    return m_digits * m_cell + m_point;
+}
+
+/**
+ * @brief The field height
+ *
+ * @return the height in pixels
+ */
+uint8_t Numeric_Field::height()
+{
+    return m_height;
+}
+
+/**
+ * @brief Format a value into the digit cells, right aligned
+ *
+ * @param value the fixed-point value
+ * @param text the character of each cell
+ */
+void Numeric_Field::format(int32_t value, char *text)
+{
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : value;
+    int8_t units = m_digits - m_decimals - 1; // Cell of the units digit, always shown
+    int8_t cell = m_digits - 1;
+
+    for (; cell >= 0; cell--)
+    {
+        if (magnitude == 0 && cell < units && !m_zeros)
+            break;
+        if (value < 0 && m_zeros && cell == 0 && units > 0)
+            break; // Leave the first cell for the sign
+        text[cell] = '0' + magnitude % 10;
+        magnitude /= 10;
+    }
+
+    if (magnitude || (value < 0 && cell < 0))
+    /*
+     * Does not fit
+     */
+    {
+        memset(text, '-', m_digits);
+        return;
+    }
+
+    if (value < 0)
+        text[cell--] = '-';
+    for (; cell >= 0; cell--)
+    {
+        text[cell] = ' ';
+    }
+}
+
+/**
+ * @brief Blit a character into a cell, opaque
+ *
+ * @param canvas the canvas to draw on
+ * @param cell the cell
+ * @param c the character
+ */
+void Numeric_Field::draw(Canvas &canvas, uint8_t cell, char c)
+{
+    uint16_t x = m_x + cell * m_cell;
+    if (cell >= m_digits - m_decimals)
+        x += m_point;
+
+    image_t image{m_cell, m_height, IMAGE_TBLR, glyph(c), nullptr};
+    canvas.blit(x, m_y, image, ROP_COPY);
+}
+
+/**
+ * @brief The cached glyph of a character
+ *
+ * @param c a digit, '-', ' ' or '.'
+ * @return the glyph, page format
+ */
+uint8_t *Numeric_Field::glyph(char c)
+{
+    uint8_t g = c == '-' ? 10 : c == ' ' ? 11 : c == '.' ? GLYPHCOUNT : c - '0';
+    return m_glyphs + g * m_cell * m_pages;
+}
@@ -17,6 +17,26 @@
  */
 
 #include <OLED.h>
+#include "Stats.h"
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#else
+#include <mutex>
+#endif
+
+/*
+ * Guards the font managers shared by every display, see select_font
+ */
+#ifdef ESP_PLATFORM
+static portMUX_TYPE fonts_lock = portMUX_INITIALIZER_UNLOCKED;
+#define FONTS_LOCK() portENTER_CRITICAL(&fonts_lock)
+#define FONTS_UNLOCK() portEXIT_CRITICAL(&fonts_lock)
+#else
+static std::mutex fonts_lock;
+#define FONTS_LOCK() fonts_lock.lock()
+#define FONTS_UNLOCK() fonts_lock.unlock()
+#endif
 
 using std::max;
 using std::min;
@@ -196,6 +216,8 @@ Display &OLED::invert(bool invert)
  */
 Display &OLED::draw_pixel(uint8_t x, uint8_t y, color_t color)
 {
+    STATS_RASTER(draw);
+
     m_ssd1306.pixel(x, y, color);
     return *this;
 }
@@ -210,6 +232,8 @@ Display &OLED::draw_pixel(uint8_t x, uint8_t y, color_t color)
  */
 Display &OLED::draw_hline(uint8_t x, uint8_t y, uint8_t w, color_t color)
 {
+    STATS_RASTER(draw);
+
     if ((w == 0) || (x >= width()) || (y >= height()))
         return *this;
 
@@ -227,6 +251,8 @@ Display &OLED::draw_hline(uint8_t x, uint8_t y, uint8_t w, color_t color)
  */
 Display &OLED::draw_vline(uint8_t x, uint8_t y, uint8_t h, color_t color)
 {
+    STATS_RASTER(draw);
+
     if ((h == 0) || (x >= width()) || (y >= height()))
         return *this;
 
@@ -247,6 +273,8 @@ Display &OLED::draw_vline(uint8_t x, uint8_t y, uint8_t h, color_t color)
  */
 Display &OLED::draw_line(uint8_t x, uint8_t y, uint8_t xx, uint8_t yy, color_t color)
 {
+    STATS_RASTER(draw);
+
     if ((x >= width()) || (y >= height()))
         return *this;
 
@@ -255,6 +283,48 @@ Display &OLED::draw_line(uint8_t x, uint8_t y, uint8_t xx, uint8_t yy, color_t c
     return *this;
 }
 
+/**
+ * @brief   Draw connected aliased lines through a set of points
+ * 
+ * @param   xs      X coordinates of the points
+ * @param   ys      Y coordinates of the points
+ * @param   count   Number of points
+ * @param   color   Color of the lines
+ * @return  Display - Fluent
+ */
+Display &OLED::draw_polyline(const uint8_t *xs, const uint8_t *ys, uint8_t count, color_t color)
+{
+    STATS_RASTER(draw);
+
+    if (count == 0 || xs == nullptr || ys == nullptr)
+        return *this;
+
+    m_ssd1306.polyline(xs, ys, count, color);
+
+    return *this;
+}
+
+/**
+ * @brief   Draw a sparkline, connected points on consecutive columns
+ * 
+ * @param   x       X coordinate of the first point
+ * @param   ys      Y coordinates of the points
+ * @param   count   Number of points
+ * @param   color   Color of the lines
+ * @return  Display - Fluent
+ */
+Display &OLED::draw_sparkline(uint8_t x, const uint8_t *ys, uint8_t count, color_t color)
+{
+    STATS_RASTER(draw);
+
+    if (count == 0 || ys == nullptr || x >= width())
+        return *this;
+
+    m_ssd1306.sparkline(x, ys, count, color);
+
+    return *this;
+}
+
 /**
  * @brief   Draw a rectangle
  * 
@@ -266,6 +336,8 @@ Display &OLED::draw_line(uint8_t x, uint8_t y, uint8_t xx, uint8_t yy, color_t c
  */
 Display &OLED::draw_rectangle(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_t color)
 {
+    STATS_RASTER(draw);
+
     if ((w == 0) || (h == 0) || (x >= width()) || (y >= height()))
         return *this;
     m_ssd1306.vertical(x, y, color, h);
@@ -286,6 +358,8 @@ Display &OLED::draw_rectangle(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_
  */
 Display &OLED::fill_rectangle(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_t color)
 {
+    STATS_RASTER(draw);
+
     if ((w == 0) || (h == 0) || (x >= width()) || (y >= height()))
         return *this;
 
@@ -304,6 +378,8 @@ Display &OLED::fill_rectangle(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_
  */
 Display &OLED::draw_circle(uint8_t x0, uint8_t y0, uint8_t r, color_t color)
 {
+    STATS_RASTER(draw);
+
     if (r == 0)
         return *this;
 
@@ -327,6 +403,8 @@ Display &OLED::draw_circle(uint8_t x0, uint8_t y0, uint8_t r, color_t color)
  */
 Display &OLED::fill_circle(uint8_t x0, uint8_t y0, uint8_t r, color_t color)
 {
+    STATS_RASTER(draw);
+
     if (r == 0)
         return *this;
 
@@ -334,8 +412,8 @@ Display &OLED::fill_circle(uint8_t x0, uint8_t y0, uint8_t r, color_t color)
     sort(points.begin(), points.end(), compareSliceX); 
 
     uint8_t x{points[0].x};
-    int8_t y;
-    int8_t yy;
+    int8_t y{points[0].y};
+    int8_t yy{points[0].yy};
 
     for (auto &point : points)
     {
@@ -353,6 +431,126 @@ Display &OLED::fill_circle(uint8_t x0, uint8_t y0, uint8_t r, color_t color)
     return *this;
 }
 
+/**
+ * @brief   Draw an image or sprite
+ * 
+ * @param   x       X coordinate of the image left, may be negative
+ * @param   y       Y coordinate of the image top, may be negative
+ * @param   image   The image, with optional mask
+ * @param   rop     How the image is combined with the display
+ * @return  Display - Fluent
+ */
+Display &OLED::draw_image(int16_t x, int16_t y, const image_t &image, rop_t rop)
+{
+    STATS_RASTER(draw);
+
+    m_ssd1306.blit(x, y, image, rop);
+    return *this;
+}
+
+/**
+ * @brief   Composite an off-screen canvas onto the display
+ * 
+ * @param   canvas  The canvas
+ * @param   x       X coordinate of the canvas left, may be negative
+ * @param   y       Y coordinate of the canvas top, may be negative
+ * @param   rop     How the canvas is combined with the display
+ * @return  Display - Fluent
+ */
+Display &OLED::composite(Canvas &canvas, int16_t x, int16_t y, rop_t rop)
+{
+    STATS_RASTER(draw);
+
+    m_ssd1306.blit(x, y, canvas.image(), rop);
+    return *this;
+}
+
+/**
+ * @brief   Show a window onto a canvas larger than the display
+ * 
+ * The display is filled with the canvas area whose top-left corner is at (left, top), so
+ * moving the corner pans the view across the canvas.
+ * 
+ * @param   canvas  The virtual screen canvas
+ * @param   left    X coordinate in the canvas of the display left
+ * @param   top     Y coordinate in the canvas of the display top
+ * @return  Display - Fluent
+ */
+Display &OLED::viewport(Canvas &canvas, int16_t left, int16_t top)
+{
+    STATS_RASTER(draw);
+
+    m_ssd1306.blit(-left, -top, canvas.image(), ROP_COPY);
+    return *this;
+}
+
+/**
+ * @brief   Add a sample to a chart, drawing the new column if one completes
+ * 
+ * Only the chart area is touched: the plot is scrolled and the new segment drawn.
+ * 
+ * @param   chart   The chart
+ * @param   sample  The sample value
+ * @param   color   Color of the plot
+ * @return  Display - Fluent
+ */
+Display &OLED::plot(Chart &chart, int16_t sample, color_t color)
+{
+    STATS_RASTER(draw);
+
+    if (chart.push(sample))
+        chart.append(m_ssd1306, color);
+    return *this;
+}
+
+/**
+ * @brief   Redraw a chart in full
+ * 
+ * @param   chart   The chart
+ * @param   color   Color of the plot
+ * @return  Display - Fluent
+ */
+Display &OLED::draw_chart(Chart &chart, color_t color)
+{
+    STATS_RASTER(draw);
+
+    chart.redraw(m_ssd1306, color);
+    return *this;
+}
+
+/**
+ * @brief   Show a value in a numeric field, drawing only the digits that changed
+ * 
+ * @param   field       The field
+ * @param   value       The value, fixed-point in units of the field's last decimal place
+ * @param   outcells    Number of digit cells drawn
+ * @return  Display - Fluent
+ */
+Display &OLED::draw_number(Numeric_Field &field, int32_t value, uint8_t *outcells)
+{
+    STATS_RASTER(draw);
+
+    uint8_t cells = field.update(m_ssd1306, value);
+
+    if (outcells != nullptr)
+        *outcells = cells;
+    return *this;
+}
+
+/**
+ * @brief   Redraw a numeric field in full, after a clear or drawing over it
+ * 
+ * @param   field   The field
+ * @return  Display - Fluent
+ */
+Display &OLED::draw_field(Numeric_Field &field)
+{
+    STATS_RASTER(draw);
+
+    field.redraw(m_ssd1306);
+    return *this;
+}
+
 /**
  * @brief   Draw one character using currently selected font
  * 
@@ -363,13 +561,14 @@ Display &OLED::fill_circle(uint8_t x0, uint8_t y0, uint8_t r, color_t color)
  * @param   y           Y position of character (top-left corner)
  * @param   c           The character to draw
  * @param   foreground  Character color
- * @param   background  Background color
+ * @param   background  Background color, or TRANSPARENT to draw only the characters
  * @return  Width of the character
  */
 
 Display &OLED::draw_char(uint8_t x, uint8_t y, unsigned char c, color_t foreground, color_t background,
                          uint8_t *outwidth)
 {
+    STATS_RASTER(draw);
     ESP_LOGD(TAG, "draw_char");
 
     if (m_font_manager == nullptr || c == 0)
@@ -379,21 +578,10 @@ Display &OLED::draw_char(uint8_t x, uint8_t y, unsigned char c, color_t foregrou
         return *this;
     }
 
-    Font_Manager::bitmap scan = m_font_manager->rasterize(c, y);
-    uint8_t *d = scan.data;
-    uint16_t ylimit = (y / 8) + scan.height_bytes;
-    uint16_t xlimit = x + scan.width_bytes;
-
-    for (int yy = y / 8; yy < ylimit; yy++)
-    {
-        for (int xx = x; xx < xlimit; xx++)
-        {
-            m_ssd1306.segment(yy, xx, *d++, foreground);
-        }
-    }
+    uint16_t w = m_ssd1306.text(x, y, *m_font_manager, c, foreground, background, m_style);
 
     if (outwidth != nullptr)
-        *outwidth = (scan.bitwidth);
+        *outwidth = w;
     return *this;
 } // draw_char
 
@@ -404,13 +592,15 @@ Display &OLED::draw_char(uint8_t x, uint8_t y, unsigned char c, color_t foregrou
  * @param   y           Y position of string (top-left corner)
  * @param   str         The string to draw
  * @param   foreground  Character color
- * @param   background  Background color
+ * @param   background  Background color, or TRANSPARENT to draw only the characters
  * @return  Width of the string (out-of-display pixels also included)
  * @return  Display - Fluent
  */
 Display &OLED::draw_string(uint8_t x, uint8_t y, std::string str, color_t foreground, color_t background,
                            uint8_t *outwidth)
 {
+    STATS_RASTER(draw);
+
     if (m_font_manager == nullptr || str.empty())
     {
         if (outwidth != nullptr)
@@ -418,21 +608,155 @@ Display &OLED::draw_string(uint8_t x, uint8_t y, std::string str, color_t foregr
         return *this;
     }
 
-    Font_Manager::bitmap scan = m_font_manager->rasterize(str, y);
-    uint8_t *d = scan.data;
-    uint16_t ylimit = (y / 8) + scan.height_bytes;
-    uint16_t xlimit = x + scan.width_bytes;
+    uint16_t w = m_ssd1306.text(x, y, *m_font_manager, str, foreground, background, m_style);
+
+    if (outwidth != nullptr)
+        *outwidth = w;
+    return *this;
+}
+
+/**
+ * @brief   Draw string turned a quarter anticlockwise, reading upwards, using currently selected font
+ * 
+ * The font is rasterized row by row, which laid into the pages is the turned text, so there is
+ * no per bit transposing; for axis labels on the side of charts.
+ * 
+ * @param   x           X position of string (top-left corner, the top of the characters)
+ * @param   y           Y position of string (top-left corner, the end of the string)
+ * @param   str         The string to draw
+ * @param   foreground  Character color
+ * @param   background  Background color, or TRANSPARENT to draw only the characters
+ * @param   outheight   Height of the string (out-of-display pixels also included)
+ * @return  Display - Fluent
+ */
+Display &OLED::draw_string_vertical(uint8_t x, uint8_t y, std::string str, color_t foreground, color_t background,
+                                    uint8_t *outheight)
+{
+    STATS_RASTER(draw);
+
+    if (m_vertical_font == nullptr || str.empty())
+    {
+        if (outheight != nullptr)
+            *outheight = 0;
+        return *this;
+    }
+
+    uint16_t h = m_ssd1306.text_vertical(x, y, *m_vertical_font, str, foreground, background);
+
+    if (outheight != nullptr)
+        *outheight = h;
+    return *this;
+}
+
+/**
+ * @brief   Draw string magnified using currently selected font
+ * 
+ * Each pixel of the font becomes a scale by scale block, so a small font serves for big
+ * readouts.
+ * 
+ * @param   x           X position of string (top-left corner)
+ * @param   y           Y position of string (top-left corner)
+ * @param   str         The string to draw
+ * @param   scale       Magnification, 2 to 4
+ * @param   foreground  Character color
+ * @param   background  Background color, or TRANSPARENT to draw only the characters
+ * @param   outwidth    Width of the string (out-of-display pixels also included)
+ * @return  Display - Fluent
+ */
+Display &OLED::draw_string_scaled(uint8_t x, uint8_t y, std::string str, uint8_t scale, color_t foreground,
+                                  color_t background, uint8_t *outwidth)
+{
+    STATS_RASTER(draw);
 
-    for (int yy = y / 8; yy < ylimit; yy++)
+    if (m_font_manager == nullptr || str.empty())
     {
-        for (int xx = x; xx < xlimit; xx++)
+        if (outwidth != nullptr)
+            *outwidth = 0;
+        return *this;
+    }
+
+    uint16_t w = m_ssd1306.text_scaled(x, y, *m_font_manager, str, scale, foreground, background, m_style);
+
+    if (outwidth != nullptr)
+        *outwidth = w;
+    return *this;
+}
+
+/**
+ * @brief   Draw text in a box, broken into lines and aligned, using currently selected font
+ *
+ * Lines are a font height plus a pixel apart, and only lines wholly inside the box are drawn.
+ * The layout is memoized, so redrawing the same text in the same box does not measure it again.
+ * An opaque background fills the box around the lines.
+ *
+ * @param   x           Box left
+ * @param   y           Box top
+ * @param   w           Box width
+ * @param   h           Box height
+ * @param   str         Text, paragraphs separated by newlines
+ * @param   foreground  Text color
+ * @param   background  Background color, or TRANSPARENT to draw only the characters
+ * @param   align       Alignment of the lines in the box
+ * @param   flags       Layout flags, LAYOUT_WRAP and LAYOUT_ELLIPSIS
+ * @param   outlines    Number of lines drawn
+ * @return  Display - Fluent
+ */
+Display &OLED::draw_text(uint8_t x, uint8_t y, uint8_t w, uint8_t h, const std::string &str, color_t foreground,
+                         color_t background, align_t align, uint8_t flags, uint8_t *outlines)
+{
+    STATS_RASTER(draw);
+
+    if (m_font_manager == nullptr)
+    {
+        if (outlines != nullptr)
+            *outlines = 0;
+        return *this;
+    }
+
+    const Text_Layout::layout_t &layout = m_layout.layout(*m_font_manager, str, w, h, flags);
+    uint8_t height = m_font_manager->font_height();
+    uint16_t top = y;
+
+    for (uint8_t i = 0; i < layout.count; i++, top += layout.pitch)
+    {
+        const Text_Layout::line_t &line = layout.lines[i];
+        uint16_t left = x + m_layout.left(line, w, align);
+
+        if (line.ellipsis)
+        /*
+         * The dots first, so a bold line's last stroke spills onto them
+         */
+        {
+            uint16_t dots = 3 * m_font_manager->char_width('.');
+            m_ssd1306.text(left + line.width - dots, top, *m_font_manager, "...", 3, foreground, background, m_style);
+        }
+        m_ssd1306.text(left, top, *m_font_manager, str.data() + line.start, line.length, foreground, background,
+                       m_style);
+
+        if (background != TRANSPARENT)
+        /*
+         * The box either side of the line and the row below it
+         */
         {
-            m_ssd1306.segment(yy, xx, *d++, foreground);
+            m_ssd1306.box(x, top, background, left - x, height);
+            if (line.width < x + w - left)
+                m_ssd1306.box(left + line.width, top, background, x + w - left - line.width, height);
+            if (i + 1 < layout.count)
+                m_ssd1306.box(x, top + height, background, w, layout.pitch - height);
         }
     }
 
-    if (outwidth != nullptr)
-        *outwidth = (scan.bitwidth);
+    if (background != TRANSPARENT)
+    /*
+     * The box below the last line
+     */
+    {
+        uint16_t bottom = layout.count ? top - layout.pitch + height : y;
+        m_ssd1306.box(x, bottom, background, w, y + h - bottom);
+    }
+
+    if (outlines != nullptr)
+        *outlines = layout.count;
     return *this;
 }
 
@@ -487,11 +811,90 @@ uint8_t OLED::font_c()
 /**
  * @brief   Select font for drawing
  * 
+ * The font managers of a font are made when it is first selected, and shared by every display
+ * from then on, so selecting fonts as often as each frame costs no heap. They are never freed.
+ * Tasks selecting a font for the first time together each make a pair outside the lock, and
+ * those that find another's already published free theirs.
+ * 
  * @param   idx     Font index, see fonts.c
  */
 Display &OLED::select_font(uint8_t idx)
 {
-    if (idx < Font_Manager::fontcount())
-        m_font_manager = new Font_Manager(idx, Font_Manager::TBLR);
+    static Font_Manager *managers[NUM_FONTS][2]; // Row and column scanned managers of each font
+
+    if (idx >= Font_Manager::fontcount())
+        return *this;
+
+    FONTS_LOCK();
+    Font_Manager *font = managers[idx][0];
+    Font_Manager *vertical = managers[idx][1];
+    FONTS_UNLOCK();
+
+    if (font == nullptr)
+    /*
+     * First selection: allocate outside the critical section, publish under it
+     */
+    {
+        Font_Manager *made = new Font_Manager(idx, Font_Manager::TBLR);
+        Font_Manager *madevertical = new Font_Manager(idx, Font_Manager::LRTB);
+
+        FONTS_LOCK();
+        if (managers[idx][0] == nullptr)
+        {
+            managers[idx][0] = made;
+            managers[idx][1] = madevertical;
+        }
+        font = managers[idx][0];
+        vertical = managers[idx][1];
+        FONTS_UNLOCK();
+
+        if (font != made)
+        {
+            delete made;
+            delete madevertical;
+        }
+    }
+
+    m_font_manager = font;
+    m_vertical_font = vertical;
+    return *this;
+}
+
+/**
+ * @brief   Select the tallest font a string fits a box with
+ * 
+ * The font is found from the font index by height then measured width, without rasterizing.
+ * When the string fits no font the selected font is kept.
+ * 
+ * @param   str         String to fit
+ * @param   w           Box width
+ * @param   h           Box height
+ * @param   charset     Character set of the string, Font_Manager::ASCII for any font
+ * @param   outfit      Whether a font was found
+ * @return  Display - Fluent
+ */
+Display &OLED::fit_font(std::string str, uint8_t w, uint8_t h, Font_Manager::Charset charset, bool *outfit)
+{
+    int16_t idx = Font_Manager::fit_font(str, w, h, charset);
+
+    if (idx >= 0)
+        select_font(idx);
+    if (outfit != nullptr)
+        *outfit = idx >= 0;
+    return *this;
+}
+
+/**
+ * @brief   Select the style of the text drawn from now on
+ * 
+ * Bold, underline, strike-through and inverse are applied to the font's raster as it is
+ * written, so one font serves for all its styles. Vertical text is drawn unstyled.
+ * 
+ * @param   style   Text style flags, STYLE_BOLD | STYLE_UNDERLINE etc, or STYLE_NORMAL
+ * @return  Display - Fluent
+ */
+Display &OLED::select_style(uint8_t style)
+{
+    m_style = style;
     return *this;
 }
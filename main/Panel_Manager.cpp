@@ -0,0 +1,241 @@
+/*
+ ESP32-SSD1306-Driver Library Panel Manager
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "Panel_Manager.h"
+
+Panel_Manager::Panel_Manager()
+{
+    m_done = xEventGroupCreate();
+    for (uint8_t i = 0; i < MAX_BUSES; i++)
+    {
+        m_buses[i].manager = this;
+        m_buses[i].index = i;
+    }
+}
+
+/**
+ * @brief Stop the bus tasks, after any refresh in flight completes
+ */
+Panel_Manager::~Panel_Manager()
+{
+    EventBits_t running = m_running;
+
+    if (running)
+    {
+        xEventGroupWaitBits(m_done, running, pdTRUE, pdTRUE, portMAX_DELAY);
+        for (uint8_t i = 0; i < MAX_BUSES; i++)
+        {
+            if (m_buses[i].task == nullptr)
+                continue;
+
+            m_buses[i].stop = true;
+            xTaskNotifyGive(m_buses[i].task);
+        }
+        xEventGroupWaitBits(m_done, running, pdTRUE, pdTRUE, portMAX_DELAY);
+    }
+
+    vEventGroupDelete(m_done);
+}
+
+/**
+ * @brief Add a panel to a bus
+ *
+ * @param panel the panel
+ * @param bus the bus the panel is wired to
+ * @return false if the bus is unknown or full, or the manager started
+ */
+bool Panel_Manager::add(SSD1306 &panel, uint8_t bus)
+{
+    if (bus >= MAX_BUSES || m_buses[bus].count >= MAX_PANELS || m_buses[bus].task != nullptr)
+    {
+        ESP_LOGE(TAG, "add - bus %d cannot take a panel", bus);
+        return false;
+    }
+
+    m_buses[bus].panels[m_buses[bus].count++] = &panel;
+    m_panelled |= 1 << bus;
+    return true;
+}
+
+/**
+ * @brief Set the core and priority of a bus task
+ *
+ * @param bus the bus
+ * @param core the core the bus task is pinned to, or tskNO_AFFINITY
+ * @param priority the bus task priority
+ * @return false if the bus is unknown or the manager started
+ */
+bool Panel_Manager::bus(uint8_t bus, BaseType_t core, UBaseType_t priority)
+{
+    if (bus >= MAX_BUSES || m_buses[bus].task != nullptr)
+        return false;
+
+    m_buses[bus].core = core;
+    m_buses[bus].priority = priority;
+    return true;
+}
+
+/**
+ * @brief Start a task for each bus with panels
+ *
+ * May be called again to start the buses added since, or those whose task failed to start.
+ *
+ * @return true if the tasks started
+ */
+bool Panel_Manager::start()
+{
+    for (uint8_t i = 0; i < MAX_BUSES; i++)
+    {
+        bus_t &bus = m_buses[i];
+        if (bus.count == 0 || bus.task != nullptr)
+            continue;
+
+        char name[] = "oled_bus0";
+        name[sizeof(name) - 2] += i;
+
+        if (xTaskCreatePinnedToCore(run, name, CONFIG_SSD1306_BUS_TASK_STACK, &bus, bus.priority, &bus.task,
+                                    bus.core) != pdPASS)
+        {
+            ESP_LOGE(TAG, "start - bus %d task not created", i);
+            bus.task = nullptr;
+            return false;
+        }
+        ESP_LOGI(TAG, "start - bus %d, %d panels, core %d", i, bus.count, bus.core);
+        m_running |= 1 << i;
+        xEventGroupSetBits(m_done, 1 << i); // Nothing in flight
+    }
+
+    return true;
+}
+
+/**
+ * @brief Start a refresh of every panel, without waiting for it to complete
+ *
+ * Each bus refreshes its panels in turn, the buses in parallel.
+ *
+ * @param force refresh the whole of each panel
+ */
+void Panel_Manager::refresh(bool force)
+{
+    xEventGroupClearBits(m_done, m_running);
+
+    for (uint8_t i = 0; i < MAX_BUSES; i++)
+    {
+        if (m_buses[i].task == nullptr)
+            continue;
+
+        m_buses[i].force = force;
+        xTaskNotifyGive(m_buses[i].task);
+    }
+}
+
+/**
+ * @brief Wait for the refresh of every bus to complete
+ *
+ * Only the buses whose task is running are waited on.
+ *
+ * @param timeout ticks to wait
+ * @return true if all the buses completed, false if a bus with panels has no task running
+ */
+bool Panel_Manager::wait(TickType_t timeout)
+{
+    if (m_running && (xEventGroupWaitBits(m_done, m_running, pdFALSE, pdTRUE, timeout) & m_running) != m_running)
+        return false;
+
+    return (m_panelled & ~m_running) == 0;
+}
+
+/**
+ * @brief Wait for the refresh of one bus to complete, so its panels can be drawn on
+ *
+ * @param bus the bus
+ * @param timeout ticks to wait
+ * @return true if the bus completed, false if it has no task running
+ */
+bool Panel_Manager::wait(uint8_t bus, TickType_t timeout)
+{
+    if (bus >= MAX_BUSES || !(m_running & (1 << bus)))
+        return false;
+
+    EventBits_t bit = 1 << bus;
+
+    return xEventGroupWaitBits(m_done, bit, pdFALSE, pdTRUE, timeout) & bit;
+}
+
+/**
+ * @brief Refresh every panel and wait for completion
+ *
+ * @param force refresh the whole of each panel
+ * @param timeout ticks to wait
+ * @return true if all the buses completed
+ */
+bool Panel_Manager::refresh_all(bool force, TickType_t timeout)
+{
+    refresh(force);
+    return wait(timeout);
+}
+
+/**
+ * @brief Duration of a bus's last refresh
+ *
+ * @param bus the bus
+ * @return the refresh time in ticks
+ */
+uint32_t Panel_Manager::frame_ticks(uint8_t bus)
+{
+    return bus < MAX_BUSES ? m_buses[bus].ticks : 0;
+}
+
+/**
+ * @brief Bus task, refreshes the bus panels each time it is notified
+ *
+ * @param arg the bus
+ */
+void Panel_Manager::run(void *arg)
+{
+    bus_t &bus = *static_cast<bus_t *>(arg);
+
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (bus.stop)
+            break;
+
+        TickType_t start = xTaskGetTickCount();
+        for (uint8_t i = 0; i < bus.count; i++)
+        {
+            bus.panels[i]->refresh(bus.force);
+        }
+        bus.ticks = xTaskGetTickCount() - start;
+
+#ifdef CONFIG_SSD1306_STATS
+        UBaseType_t headroom = uxTaskGetStackHighWaterMark(nullptr);
+        if (headroom < bus.headroom)
+        {
+            bus.headroom = headroom;
+            ESP_LOGI(TAG, "run - bus %d stack headroom %u bytes", bus.index, (unsigned)headroom);
+        }
+#endif
+
+        xEventGroupSetBits(bus.manager->m_done, 1 << bus.index);
+    }
+
+    xEventGroupSetBits(bus.manager->m_done, 1 << bus.index);
+    vTaskDelete(nullptr);
+}
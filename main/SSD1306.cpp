@@ -17,24 +17,105 @@
  */
 
 #include "SSD1306.h"
+#include "Stats.h"
+
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
 
 using std::min;
 
+/**
+ * @brief   Microsecond clock for measuring transfers
+ */
+static int64_t micros()
+{
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+/**
+ * @brief   Transpose an 8x8 bit matrix: bit i of out[k] is bit k of in[i]
+ * 
+ * Branch free SWAR, swapping ever larger blocks about the diagonal: in one 64 bit word where
+ * the CPU has them, in two 32 bit words otherwise, as on the Xtensa.
+ */
+static inline void transpose8(const uint8_t *in, uint8_t *out)
+{
+#if UINTPTR_MAX > 0xffffffffu
+    uint64_t x, t;
+    memcpy(&x, in, 8);
+    t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaull;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000cccc0000ccccull;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ull;
+    x ^= t ^ (t << 28);
+    memcpy(out, &x, 8);
+#else
+    uint32_t x, y, t;
+    memcpy(&x, in, 4);
+    memcpy(&y, in + 4, 4);
+    t = (x ^ (x >> 7)) & 0x00aa00aa;
+    x ^= t ^ (t << 7);
+    t = (y ^ (y >> 7)) & 0x00aa00aa;
+    y ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000cccc;
+    x ^= t ^ (t << 14);
+    t = (y ^ (y >> 14)) & 0x0000cccc;
+    y ^= t ^ (t << 14);
+    t = ((x >> 4) ^ y) & 0x0f0f0f0f;
+    y ^= t;
+    x ^= t << 4;
+    memcpy(out, &x, 4);
+    memcpy(out + 4, &y, 4);
+#endif
+}
+
 /**
  * @brief Construct a new SSD1306::SSD1306 object
  * 
  * @param pif Wire protocol interface adaptor
  * @param type The SSD1306 panel type
  */
-SSD1306::SSD1306(PIF *pif, panel_type_t type)
+SSD1306::SSD1306(PIF *pif, panel_type_t type) : SSD1306(pif, panel_geometry(COLUMNS, type * 8))
 {
-    m_pif = pif;
-    m_type = type;
-    m_buffer = new uint8_t[m_type][COLUMNS]; // Display buffer - Page by Column
-    m_buffer_bytes = m_type * COLUMNS;
-    ESP_LOGI(TAG, "SSD1306 type:%d buffer size: %d buffer at %p\n", m_type, m_buffer_bytes, m_buffer);
-    m_height = m_type * 8;         // panel height (32 or 64)
-    m_pixels = m_width * m_height; // panel pixel count
+}
+
+/**
+ * @brief Construct a new SSD1306::SSD1306 object with a heap display buffer
+ * 
+ * @param pif Wire protocol interface adaptor
+ * @param geometry The panel geometry
+ */
+SSD1306::SSD1306(PIF *pif, const panel_geometry_t &geometry)
+    : Canvas(geometry.width, geometry.height), m_pif{pif}, m_geometry(geometry)
+{
+    m_shadow = new uint8_t[m_buffer_bytes]();
+    m_shadow_owner = true;
+    ESP_LOGI(TAG, "SSD1306 %dx%d buffer size: %u buffer at %p\n", m_width, m_height, (unsigned)m_buffer_bytes,
+             m_buffer);
+}
+
+/**
+ * @brief Construct a new SSD1306::SSD1306 object over a provided display buffer
+ * 
+ * @param pif Wire protocol interface adaptor
+ * @param buffer Display buffer of geometry.width * geometry.height / 8 bytes
+ * @param geometry The panel geometry
+ * @param shadow Buffer of the same size for the frame last sent, nullptr to send every change drawn
+ */
+SSD1306::SSD1306(PIF *pif, uint8_t *buffer, const panel_geometry_t &geometry, uint8_t *shadow)
+    : Canvas(buffer, geometry.width, geometry.height), m_pif{pif}, m_geometry(geometry), m_shadow{shadow}
+{
+    ESP_LOGI(TAG, "SSD1306 %dx%d buffer size: %u buffer at %p\n", m_width, m_height, (unsigned)m_buffer_bytes,
+             m_buffer);
 }
 
 /**
@@ -47,23 +128,18 @@ bool SSD1306::init()
     ESP_LOGI(TAG, "init - Start");
     if (m_init)
         return false;
+    if (m_geometry.height > MAX_PAGES * 8)
+    {
+        ESP_LOGE(TAG, "init - %d rows, the controller drives up to %d", m_geometry.height, MAX_PAGES * 8);
+        return false;
+    }
     m_init = true;
     powerdown();
 
-    // Now we assume all sending will be successful
-    if (m_type == SSD1306_128x64)
-    {
-        ESP_LOGD(TAG, "\tcmd: init 64");
-        m_pif->command(initcmds64, sizeof(initcmds64));
-    }
-    else if (m_type == SSD1306_128x32)
+    if (!configure())
     {
-        ESP_LOGD(TAG, "\tcmd: init 32");
-        m_pif->command(initcmds32, sizeof(initcmds32));
-    }
-    else
-    {
-        ESP_LOGE(TAG, "init - Unknown display type");
+        ESP_LOGE(TAG, "init - Panel not responding");
+        m_init = false;
         return false;
     }
 
@@ -71,12 +147,27 @@ bool SSD1306::init()
     refresh(true);
 
     ESP_LOGD(TAG, "\tcmd: ON");
-    m_pif->command(CMD_DISPLAYON);
+    uint8_t on{CMD_DISPLAYON};
+    if (!command(&on, 1))
+    {
+        ESP_LOGE(TAG, "init - Panel not turned on");
+        m_init = false;
+        return false;
+    }
 
     ESP_LOGI(TAG, "init - Complete");
     return true;
 }
 
+/**
+ * @brief   Transport error counters
+ * @return  the counters
+ */
+const transport_errors_t &SSD1306::errors()
+{
+    return m_errors;
+}
+
 /**
  * @brief   Turn off display and power, free memory
  * @return  true if successful
@@ -90,306 +181,839 @@ void SSD1306::powerdown()
     memset(m_buffer, 0, m_height / 8);
 }
 
-/**
- * @brief   Return OLED panel height
- * @return  Panel height, or return 0 if failed (panel not initialized)
- */
-uint8_t SSD1306::width()
-{
-    return m_width;
-}
-
-/**
- * @brief   Return OLED panel height
- * @return  Panel height, or return 0 if failed (panel not initialized)
- */
-uint8_t SSD1306::height()
-{
-    return m_height;
-}
-
 /**
  * @brief   Clear display buffer (fill with black)
+ * 
+ * With the frame last sent kept, only the columns lit on the panel are marked dirty, and refresh
+ * sends only those the drawing since leaves changed, so the common clear, draw, refresh loop
+ * sends just the difference between frames.
+ * 
  * @param   limit Cleared area is limited to the last refreshed area
  */
 void SSD1306::clear(bool limit)
 {
     ESP_LOGD(TAG, "clear - limit:%d", limit);
 
+    if (!limit && m_shadow == nullptr)
+    {
+        Canvas::clear();
+        return;
+    }
+
     if (!limit)
     {
+        STATS_RASTER(buffer);
         memset(m_buffer, 0, m_buffer_bytes);
-        m_dirtywindow.touch();
+
+        dirtywindow lit; // Panel columns lit
+        uint8_t width{m_geometry.width};
+        for (uint8_t page = 0; page < m_geometry.height / 8; page++)
+        {
+            if (m_unsure & (1 << page))
+            {
+                lit.touch(page, 0, width - 1);
+                continue;
+            }
+
+            const uint8_t *shown = sent(page);
+            uint16_t left{0}, right{width};
+            while (left < width && !shown[left])
+                left++;
+            if (left == width)
+                continue;
+            while (!shown[right - 1])
+                right--;
+            lit.touch(page, left, right - 1);
+        }
+        touch(m_transposed ? tiles(lit) : lit);
         return;
     }
 
     // Clear the dirty window only
 
-    uint8_t segments = 1 + m_previous_dirtywindow.rightcol - m_previous_dirtywindow.leftcol;
-    for (int page = m_previous_dirtywindow.toppage; page <= m_previous_dirtywindow.bottompage; page++)
+    uint16_t colstart, colend;
+    for (uint16_t page = m_previous_dirtywindow.toppage; page <= m_previous_dirtywindow.bottompage; page++)
     {
-        memset(m_buffer[page] + m_previous_dirtywindow.leftcol, 0, segments);
-        m_dirtywindow.touch(page, m_previous_dirtywindow.leftcol, m_previous_dirtywindow.rightcol);
+        if (!m_previous_dirtywindow.span(page, colstart, colend) || colstart >= m_width)
+            continue;
+        colend = min<uint16_t>(colend, m_width - 1);
+        memset(row(page) + colstart, 0, 1 + colend - colstart);
+        m_dirtywindow.touch(page, colstart, colend);
     }
 }
 
 /**
  * @brief   Refresh display (send display buffer to the panel)
+ * 
+ * The dirty pages are sent by the cheapest plan for their layout, see plan(). A failed transfer
+ * is retried; if it still fails the rest of the window is marked dirty again for the next
+ * refresh, and after repeated failed refreshes the panel is re-initialized and refreshed in
+ * full, recovering from a panel reset by ESD or a brown-out.
+ * 
+ * Double buffered, the changes are sent to the hidden half of the GDDRAM, with those it missed
+ * while shown, and the half is then shown, see double_buffer().
+ * 
+ * @param   force   Refresh the whole panel
+ * @return  true if the panel is up to date
  */
-void SSD1306::refresh(bool force)
+bool SSD1306::refresh(bool force)
 {
     ESP_LOGD(TAG, "refresh - Force:%d", force);
+    STATS_TIME(refresh);
 
-    if (!m_dirtywindow.isdirty)
-        return;
+    if (m_failed_refreshes >= REINIT_AFTER)
+        return recover();
 
-    uint8_t columnstart{m_dirtywindow.leftcol}, columnend{m_dirtywindow.rightcol};
-    uint8_t pagestart{m_dirtywindow.toppage};
-    uint8_t pageend{m_dirtywindow.bottompage};
-    if (pageend >= m_type)
-        pageend = m_type - 1;
-    uint8_t segments = 1 + columnend - columnstart;
+    if (!m_dirtywindow.isdirty && !force)
+        return true;
 
     if (force)
+        touch();
+
+    dirtywindow drawn = m_dirtywindow; // Changes since the last refresh
+    if (m_flip)
+        touch(m_stale); // The hidden half also lacks the changes the last flip showed
+
+    dirtywindow window = m_transposed ? tiles(m_dirtywindow) : m_dirtywindow; // Panel pages and columns
+    dirtywindow changed; // Dirty spans trimmed to the bytes differing from the frame last sent
+    uint8_t width{m_geometry.width}, pages = m_geometry.height / 8;
+    uint16_t colstart, colend;
+    for (uint16_t page = window.toppage; page <= min<uint16_t>(window.bottompage, pages - 1); page++)
+    {
+        if (!window.span(page, colstart, colend) || colstart >= width)
+            continue;
+        colend = min<uint16_t>(colend, width - 1);
+
+        bool unsure = m_unsure & (1 << page);
+        if (unsure)
+        /*
+         * Panel contents not known, resend the page in full
+         */
+        {
+            colstart = 0;
+            colend = width - 1;
+        }
+
+        if (m_transposed)
+            transpose(page, colstart, colend);
+
+        if (m_shadow && !unsure && !force && !m_flip)
+        {
+            const uint8_t *now = frame(page), *shown = sent(page);
+            while (colstart <= colend && now[colstart] == shown[colstart])
+                colstart++;
+            if (colstart > colend)
+                continue;
+            while (now[colend] == shown[colend])
+                colend--;
+        }
+        changed.touch(page, colstart, colend);
+    }
+
+    band_t bands[MAX_PAGES];
+    bool paged;
+    uint8_t count = plan(changed, bands, paged);
+    uint8_t page{0};
+    uint32_t bytes{0}; // Dirty bytes sent, for the statistics
+    bool ok{true};
+
+    if (m_flip && m_flip_failed)
     /*
-     * Define dirty pages and columns
+     * The failed flip may have been carried out, show the shown half again before writing
      */
     {
-        columnstart = 0;
-        columnend = COLUMNS - 1;
-        pagestart = 0;
-        pageend = m_type - 1;
-        segments = COLUMNS;
+        uint8_t cmd = CMD_SETDISPLAYSTARTLINE | ((m_rampage ? 0 : pages) * 8);
+        ok = command(&cmd, 1);
+        m_flip_failed = !ok;
     }
 
-    uint8_t refreshcmd[] = {CMD_COLUMNADDR, columnstart, columnend, //  Column window
-                            CMD_PAGEADDR, pagestart, pageend};      // Page window
+    for (uint8_t b = 0; ok && b < count; b++)
+    /*
+     * Send each band in transfers of whole pages
+     */
+    {
+        const band_t &band = bands[b];
+        uint8_t segments = 1 + band.rightcol - band.leftcol;
+        uint8_t pages = paged ? 1 : min(1 + band.bottompage - band.toppage, std::max(1, MAX_TRANSFER / segments));
+        bool positioned{false};
 
-    m_pif->command(refreshcmd, sizeof(refreshcmd));
+        for (page = band.toppage; page <= band.bottompage; page += pages)
+        {
+            uint8_t n = min(pages, static_cast<uint8_t>(1 + band.bottompage - page));
+            if (!transfer(page, n, band, paged, positioned))
+            {
+                ok = false;
+                break;
+            }
+            bytes += n * segments;
+        }
+    }
 
-    for (int page = pagestart; page <= pageend; page++)
+    if (ok && m_flip)
     /*
-     * Send data in up to page sized chunks
+     * Show the hidden half, hiding the shown half
      */
     {
-        m_pif->data(m_buffer[page] + columnstart, segments);
+        uint8_t cmd = CMD_SETDISPLAYSTARTLINE | (m_rampage * 8);
+        ok = command(&cmd, 1);
+        m_flip_failed = !ok;
+        if (ok)
+        {
+            m_rampage = m_rampage ? 0 : pages;
+            m_stale = drawn;
+        }
     }
 
+    if (!ok)
+    /*
+     * Failed, the panel's position in the window is unknown so resend the remainder; double
+     * buffered nothing was shown, and the hidden half is resent as it was, as is a transposed
+     * window
+     */
+    {
+        m_errors.refreshes++;
+        if (!m_flip && !m_transposed)
+        {
+            dirtywindow remainder;
+            uint16_t colstart, colend;
+            for (uint16_t p = page; p <= m_dirtywindow.bottompage; p++)
+            {
+                if (m_dirtywindow.span(p, colstart, colend))
+                    remainder.touch(p, colstart, colend);
+            }
+            m_dirtywindow = remainder;
+        }
+
+        if (++m_failed_refreshes < REINIT_AFTER)
+            return false;
+
+        ESP_LOGW(TAG, "refresh - %d failed refreshes, re-initializing", m_failed_refreshes);
+        return recover();
+    }
+
+    STATS_ADD(dirty, bytes * 8);
+    STATS_FRAME();
+
     // Clear Dirty Window
-    m_previous_dirtywindow = m_dirtywindow;
+    m_failed_refreshes = 0;
+    m_previous_dirtywindow = drawn;
     m_dirtywindow.clear();
+    return true;
 }
 
 /**
- * @brief 
- * 
-* @param   page   the page coord of the column
-* @param   column   the column # in the page
-* @param   bits   the segment bits to set
-* @param   color   the color to set the segment bits
-* @param   count   the number of consecutive segments in the page to draw
-* @return  True if segment was drawn
-* @return  True if segment was drawn 
-* @return false 
-*/
-bool SSD1306::segment(uint8_t page, uint8_t column, uint8_t bits, color_t color, uint8_t count)
+ * @brief   Set normal or inverted display
+ * @param   invert      Invert display?
+ */
+void SSD1306::invert_display(bool invert)
 {
-    // ESP_LOGD(TAG, "::segment page:%d column:%d count:%d", page, column, count);
+    ESP_LOGD(TAG, "invert_display - invert: %d", invert);
 
-    if (count == 0 || (page >= m_type) || (column >= m_width))
+    if (invert)
+        m_pif->command(CMD_INVERTDISPLAY);
+    else
+        m_pif->command(CMD_NORMALDISPLAY);
+}
+
+/**
+ * @brief   Direct update display buffer
+ * @param   data        Data to fill display buffer, no length check is performed!
+ * @param   length      Length of data
+ */
+void SSD1306::update_buffer(uint8_t *data, uint16_t length)
+{
+    ESP_LOGD(TAG, "update_buffer");
+    STATS_RASTER(buffer);
+    memcpy(m_buffer, data, min<uint32_t>(length, m_buffer_bytes));
+}
+
+/**
+ * @brief   Double buffer the panel in the GDDRAM pages it does not show
+ * 
+ * An SSD1306 panel of up to 32 rows shows at most half the GDDRAM. Double buffered, each refresh
+ * writes the hidden half and then shows it with one start line command, so a frame is never seen
+ * part written. The half hidden by the flip lacks that frame's changes, and is sent them with the
+ * next frame's.
+ * 
+ * @param   enable  Double buffer, or write the pages shown
+ * @return  true if set, false if the panel has no hidden half or could not be flipped back
+ */
+bool SSD1306::double_buffer(bool enable)
+{
+    if (m_geometry.controller != CONTROLLER_SSD1306 || m_geometry.height / 8 * 2 > SSD1306_PAGES)
         return false;
 
-    uint8_t stopbeforecolumn{static_cast<uint8_t>(column + count)};
-    if (stopbeforecolumn >= COLUMNS)
-        stopbeforecolumn = COLUMNS - 1;
+    if (enable == m_flip)
+        return true;
 
-    for (uint8_t i = column; i < stopbeforecolumn; i++)
+    if (enable)
     {
-        switch (color)
-        {
-        case WHITE:
-            m_buffer[page][i] |= bits;
-            break;
-        case BLACK:
-            m_buffer[page][i] &= ~bits;
-            break;
-        case INVERT:
-            m_buffer[page][i] ^= bits;
-            break;
-        default:
-            break;
-        } // switch
-    }     // for
-
-    m_dirtywindow.touch(page, column, stopbeforecolumn - 1);
+        m_flip = true;
+        m_rampage = m_geometry.height / 8;
+        m_stale.clear();
+        m_stale.touch(0, m_pages - 1, 0, m_width - 1); // Hidden half not known
+        return true;
+    }
+
+    if (m_rampage == 0 && !refresh(true))
+        return false; // The upper half is shown, and the lower could not be
 
+    m_flip = false;
+    m_rampage = 0;
     return true;
 }
 
 /**
- * @brief	Set the color of a single pixel
- * @param   x   the x coord of the pixel
- * @param   y   the y coord of the pixel
- * @param   color   the desired color of the pixel
- * @param	count	number of times to draw the bits
- * @return  True if pixel was drawn
+ * @brief   Set the panel orientation
+ * 
+ * The panel is turned or mirrored by the controller's segment remap and COM scan direction, so
+ * drawing is unchanged. A panel that does not show the centre GDDRAM columns shows other columns
+ * when mirrored left to right, and is refreshed in full by the next refresh.
+ * 
+ * Transposed, and so turned a quarter, the canvas takes the panel's height as its width and its
+ * width as its height, and is cleared. Refresh transposes the 8x8 tiles that are dirty into the
+ * panel frame, so the cost follows the area drawn. The panel width must be a multiple of 8.
+ * 
+ * @param   orientation The orientation
+ * @return  true if set
  */
-bool SSD1306::pixel(uint8_t x, uint8_t y, color_t color)
+bool SSD1306::orientation(orientation_t orientation)
 {
-    ESP_LOGD(TAG, "pixel - x:%d  y:%d", x, y);
-    return segment(y / 8, x, (1 << (y & 7)), color);
+    if ((orientation ^ m_orientation) & ORIENTATION_TRANSPOSE)
+    /*
+     * Swap the canvas dimensions
+     */
+    {
+        if (m_geometry.width % 8)
+            return false;
+
+        if (orientation & ORIENTATION_TRANSPOSE)
+            m_transposed = new uint8_t[m_buffer_bytes]();
+        else
+        {
+            delete[] m_transposed;
+            m_transposed = nullptr;
+        }
+
+        std::swap(m_width, m_height);
+        m_pages = m_height / 8;
+        memset(m_buffer, 0, m_buffer_bytes);
+        m_dirtywindow.clear();
+        m_previous_dirtywindow.clear();
+        m_unsure = 0xFFFF;
+        touch();
+        m_stale = m_dirtywindow;
+    }
+
+    uint8_t offset = columnoffset();
+    m_orientation = orientation;
+
+    if (columnoffset() != offset)
+    /*
+     * Columns shown not yet written
+     */
+    {
+        m_unsure = 0xFFFF;
+        touch();
+        m_stale.touch(0, m_pages - 1, 0, m_width - 1);
+    }
+
+    if (!m_init)
+        return true; // Set by init()
+
+    uint8_t cmds[]{static_cast<uint8_t>(orientation & ORIENTATION_MIRROR_H ? CMD_SETSEGREMAP_0 : CMD_SETSEGREMAP_127),
+                   static_cast<uint8_t>(orientation & ORIENTATION_MIRROR_V ? CMD_COMSCANINC : CMD_COMSCANDEC)};
+    return command(cmds, sizeof(cmds));
 }
 
 /**
- * @brief	Draw a filled box of the given color
- * @param   x   the starting x coord of the box
- * @param   y   the starting y coord of the box
- * @param   color   the color to set the box
- * @param   w   the width of the box in pixels to draw
- * @param   h   the height of the box in pixels
- * @return  True if line was drawn
+ * @brief   The panel orientation
+ * @return  the orientation
  */
-bool SSD1306::box(uint8_t x, uint8_t y, color_t color, uint8_t w, uint8_t h)
+orientation_t SSD1306::orientation()
 {
-    ESP_LOGD(TAG, "box - x:%d y:%d w:%d h:%d", x, y, w, h);
+    return m_orientation;
+}
 
-    if (w == 0 || h == 0)
+/**
+ * @brief   Send the panel configuration, built from the panel geometry
+ * @return  true if sent
+ */
+bool SSD1306::configure()
+{
+    bool sh1106{m_geometry.controller == CONTROLLER_SH1106};
+    uint8_t initcmds[32]; // Built from the panel geometry
+    uint8_t n{0};
+
+    initcmds[n++] = CMD_DISPLAYOFF;
+    initcmds[n++] = CMD_SETDISPLAYCLOCKDIV;
+    initcmds[n++] = 0x80; // Suggested value 0x80
+    initcmds[n++] = CMD_SETMULTIPLEX;
+    initcmds[n++] = m_geometry.height - 1; // 1/height
+    initcmds[n++] = CMD_SETDISPLAYOFFSET;
+    initcmds[n++] = 0x00;                        // 0 no offset
+    initcmds[n++] = CMD_SETDISPLAYSTARTLINE + 0; // line #0
+    if (!sh1106)
+    /*
+     * SH1106 style controllers only have page addressing
+     */
+    {
+        initcmds[n++] = CMD_MEMORYMODE;
+        initcmds[n++] = 0x00; // 0x0 act like ks0108
+    }
+    initcmds[n++] = m_orientation & ORIENTATION_MIRROR_H ? CMD_SETSEGREMAP_0 : CMD_SETSEGREMAP_127;
+    initcmds[n++] = m_orientation & ORIENTATION_MIRROR_V ? CMD_COMSCANINC : CMD_COMSCANDEC;
+    initcmds[n++] = CMD_SETCOMPINS;
+    initcmds[n++] = m_geometry.compins;
+    initcmds[n++] = CMD_SETCONTRAST;
+    initcmds[n++] = m_geometry.contrast;
+    initcmds[n++] = CMD_SETPRECHARGE;
+    initcmds[n++] = 0xf1;
+    initcmds[n++] = CMD_SETVCOMDETECT;
+    initcmds[n++] = m_geometry.vcomdetect;
+    if (sh1106)
+    {
+        initcmds[n++] = CMD_SH1106_DCDC;
+        initcmds[n++] = 0x8b; // DC-DC on
+    }
+    else
+    {
+        initcmds[n++] = CMD_DEACTIVATE_SCROLL;
+        initcmds[n++] = CMD_CHARGEPUMP;
+        initcmds[n++] = 0x14; // Charge pump on
+    }
+    initcmds[n++] = CMD_DISPLAYALLON_RESUME;
+    initcmds[n++] = CMD_NORMALDISPLAY;
+
+    m_rampage = m_flip ? m_geometry.height / 8 : 0; // Start line 0 shows the lower half
+    m_flip_failed = false;
+    m_stale.clear();
+    m_stale.touch(0, m_pages - 1, 0, m_width - 1);
+
+    ESP_LOGD(TAG, "\tcmd: init %dx%d", m_geometry.width, m_geometry.height);
+    bool sent = command(initcmds, n);
+    m_addressing = !sent ? ADDRESSING_UNKNOWN : (sh1106 ? ADDRESSING_PAGE : ADDRESSING_HORIZONTAL);
+    return sent;
+}
+
+/**
+ * @brief   Re-initialize the panel and refresh it in full
+ * 
+ * The panel may have reset, losing its configuration and GDDRAM. Until the configuration is
+ * accepted and the panel turned on every refresh tries again.
+ * 
+ * @return  true if the panel is up to date
+ */
+bool SSD1306::recover()
+{
+    m_errors.reinits++;
+    m_unsure = 0xFFFF;
+    if (!configure())
         return false;
 
-    w = min(w, (uint8_t)(COLUMNS - x));  // Clip X
-    h = min(h, (uint8_t)(m_height - y)); // Clip Y
+    m_failed_refreshes = 0;
+    touch();
+    bool refreshed = refresh(true);
+    uint8_t on{CMD_DISPLAYON};
+    if (!command(&on, 1))
+    /*
+     * The panel is still off, re-initialize again on the next refresh
+     */
+    {
+        m_failed_refreshes = REINIT_AFTER;
+        return false;
+    }
+    return refreshed;
+}
 
-    uint8_t pagestart = y / 8;
-    uint8_t pageend = (y + h - 1) / 8; // Do not double count origin line
+/**
+ * @brief   Send commands, retrying on failure
+ * @param   cmds    Commands to send
+ * @param   size    Number of bytes
+ * @return  true if sent
+ */
+bool SSD1306::command(uint8_t *cmds, uint8_t size)
+{
+    for (uint8_t attempt = 0; attempt <= RETRIES; attempt++)
+    {
+        if (attempt > 0)
+            m_errors.retries++;
+
+        if (m_pif->command(cmds, size))
+            return true;
+
+        m_errors.failures++;
+    }
+
+    ESP_LOGW(TAG, "command - failed after %d retries", RETRIES);
+    return false;
+}
+
+/**
+ * @brief   Bus cost of sending a band, in bytes including the transaction overheads
+ * 
+ * @param   band    The band
+ * @param   paged   Page addressing, the band is one page
+ * @return  the cost
+ */
+uint32_t SSD1306::cost(const band_t &band, bool paged)
+{
+    uint32_t segments = 1 + band.rightcol - band.leftcol;
+    uint32_t pages = 1 + band.bottompage - band.toppage;
+    uint32_t perpage = paged ? 1 : std::max<uint32_t>(1, MAX_TRANSFER / segments);
+    uint32_t transactions = 1 + (pages + perpage - 1) / perpage;
+
+    return (paged ? 3 : 6) + pages * segments + transactions * m_overhead;
+}
+
+/**
+ * @brief   Plan the refresh of a dirty window
+ * 
+ * The dirty pages can be sent as one window burst over the whole dirty window, as windows over
+ * runs of pages whose dirty columns are alike, or with page addressing, positioning each dirty
+ * page with three command bytes instead of a six byte window but with a transaction per page.
+ * The cheapest by the measured transaction overhead is chosen: a burst for large or compact
+ * updates, separate windows for far apart areas, pages for a few short spans.
+ * 
+ * SH1106 style controllers only have page addressing.
+ * 
+ * @param   window  The dirty window
+ * @param   bands   The windows to send, in page order, one per page with page addressing
+ * @param   paged   Page addressing is to be used, set
+ * @return  the number of bands
+ */
+uint8_t SSD1306::plan(const dirtywindow &window, band_t *bands, bool &paged)
+{
+    paged = true;
+    if (!window.isdirty)
+        return 0; // Nothing differs from the frame last sent
 
-    uint8_t seg = y % 8;          // Start segment
-    uint8_t yremainder = 8 - seg; // Number of bits to draw
-    uint8_t filler = BITS[min(yremainder, h) - 1] << seg;
+    uint8_t top{window.toppage}, bottom = min<uint8_t>(window.bottompage, m_geometry.height / 8 - 1);
+    uint16_t left[MAX_PAGES], right[MAX_PAGES];
+    bool dirty[MAX_PAGES];
+    uint32_t pagescost{0};
+    uint8_t pages{0};
 
+    for (uint8_t page = top; page <= bottom; page++)
     /*
-     * First page
+     * Page addressing: each dirty page on its own
      */
-    segment(pagestart, x, filler, color, w);
+    {
+        dirty[page] = window.span(page, left[page], right[page]) && left[page] < m_geometry.width;
+        if (!dirty[page])
+            continue;
+        right[page] = min<uint16_t>(right[page], m_geometry.width - 1);
+        bands[pages] = band_t{page, page, static_cast<uint8_t>(left[page]), static_cast<uint8_t>(right[page])};
+        pagescost += cost(bands[pages++], true);
+    }
+
+    if (m_geometry.controller == CONTROLLER_SH1106)
+        return pages;
 
-    for (uint8_t p = (pagestart + 1); p < (pageend); p++)
     /*
-     * Fill intermediate pages, if more than two pages
+     * Windows: the cheapest division of the dirty pages into runs, each run a window over the
+     * columns dirty in any of its pages. A single run is the window burst.
      */
+    uint32_t best[MAX_PAGES + 1]; // Cost of the pages before each page
+    uint8_t start[MAX_PAGES + 1]; // Start of the last run, the page itself where it is skipped
+    best[top] = 0;
+    for (uint8_t end = top; end <= bottom; end++)
     {
-        segment(p, x, 0xFF, color, w);
+        best[end + 1] = best[end];
+        start[end + 1] = end + 1;
+        if (!dirty[end])
+            continue;
+
+        best[end + 1] = UINT32_MAX;
+        band_t run{end, end, static_cast<uint8_t>(left[end]), static_cast<uint8_t>(right[end])};
+        for (int first = end; first >= top; first--)
+        {
+            if (!dirty[first])
+                continue;
+            run.toppage = first;
+            run.leftcol = min<uint16_t>(run.leftcol, left[first]);
+            run.rightcol = std::max<uint16_t>(run.rightcol, right[first]);
+            uint32_t total = best[first] + cost(run, false);
+            if (total < best[end + 1])
+            {
+                best[end + 1] = total;
+                start[end + 1] = first;
+            }
+        }
     }
 
     /*
-     * Last page, if multiple pages
+     * Changing addressing mode adds a command to the first transfer
      */
-    if (pageend > pagestart)
+    if (m_addressing != ADDRESSING_PAGE)
+        pagescost += 2;
+    uint32_t windowscost = best[bottom + 1] + (m_addressing != ADDRESSING_HORIZONTAL ? 2 : 0);
+    if (pagescost < windowscost)
     {
-        seg = (y + h - 1) % 8; // Number of bits to draw
-        filler = BITS[seg];    // Get bit pattern a
-        segment(pageend, x, filler, color, w);
+        ESP_LOGD(TAG, "plan - %d pages, cost %d", pages, pagescost);
+        return pages;
     }
-    return true;
+
+    uint8_t count{0};
+    for (int end = bottom + 1; end > top;)
+    /*
+     * Walk back through the runs
+     */
+    {
+        uint8_t first = start[end];
+        if (first == end)
+        {
+            end--;
+            continue;
+        }
+
+        band_t run{first, static_cast<uint8_t>(end - 1), 0xFF, 0};
+        for (uint8_t page = first; page < end; page++)
+        {
+            if (!dirty[page])
+                continue;
+            run.leftcol = min<uint16_t>(run.leftcol, left[page]);
+            run.rightcol = std::max<uint16_t>(run.rightcol, right[page]);
+        }
+        bands[count++] = run;
+        end = first;
+    }
+    std::reverse(bands, bands + count);
+
+    paged = false;
+    ESP_LOGD(TAG, "plan - %d windows, cost %d", count, windowscost);
+    return count;
+}
+
+/**
+ * @brief   Send pages of a band, retrying on failure
+ * 
+ * The panel's GDDRAM pointer is positioned as needed: per page with page addressing, or with a
+ * window over the rest of the band that subsequent pages follow on in. Several pages are sent
+ * in one transfer where the band is narrow enough. The addressing mode is changed with the
+ * positioning if needed. A failed transfer may have moved the pointer part way, so the retry
+ * repositions it, and a failed command may have been left part sent, so the next positioning
+ * first completes it with no-ops.
+ * 
+ * @param   page        First page to send
+ * @param   pages       Pages to send
+ * @param   band        The band being sent
+ * @param   paged       Page addressing
+ * @param   positioned  The pointer is at this page, updated
+ * @return  true if sent
+ */
+bool SSD1306::transfer(uint8_t page, uint8_t pages, const band_t &band, bool paged, bool &positioned)
+{
+    bool sh1106{m_geometry.controller == CONTROLLER_SH1106};
+    uint8_t ramcolumn = band.leftcol + columnoffset(); // GDDRAM column of the window
+    uint8_t segments = 1 + band.rightcol - band.leftcol;
+    uint8_t size = pages * segments;
+    uint8_t *bytes = frame(page) + band.leftcol;
+    uint8_t burst[MAX_TRANSFER];
+
+    if (pages > 1 && segments != m_geometry.width)
+    /*
+     * Gather the pages of a narrow window
+     */
+    {
+        for (uint8_t i = 0; i < pages; i++)
+        {
+            memcpy(burst + i * segments, frame(page + i) + band.leftcol, segments);
+        }
+        bytes = burst;
+    }
+
+    for (uint8_t attempt = 0; attempt <= RETRIES; attempt++)
+    {
+        if (attempt > 0)
+            m_errors.retries++;
+
+        if (!positioned)
+        {
+            addressing_t mode = paged ? ADDRESSING_PAGE : ADDRESSING_HORIZONTAL;
+            uint8_t cmds[10];
+            uint8_t n{0};
+            if (m_addressing == ADDRESSING_UNKNOWN)
+            /*
+             * Complete any command left part sent by a failure, with up to two argument bytes
+             */
+            {
+                cmds[n++] = CMD_NOP;
+                cmds[n++] = CMD_NOP;
+            }
+            if (!sh1106 && m_addressing != mode)
+            {
+                cmds[n++] = CMD_MEMORYMODE;
+                cmds[n++] = paged ? 0x02 : 0x00;
+            }
+            if (paged)
+            {
+                cmds[n++] = CMD_SETPAGESTART | (m_rampage + page);
+                cmds[n++] = CMD_SETLOWCOLUMN | (ramcolumn & 0x0f);
+                cmds[n++] = CMD_SETHIGHCOLUMN | (ramcolumn >> 4);
+            }
+            else
+            {
+                cmds[n++] = CMD_COLUMNADDR; // Column window
+                cmds[n++] = ramcolumn;
+                cmds[n++] = ramcolumn + segments - 1;
+                cmds[n++] = CMD_PAGEADDR; // Page window
+                cmds[n++] = m_rampage + page;
+                cmds[n++] = m_rampage + band.bottompage;
+            }
+            positioned = send(false, cmds, n);
+            m_addressing = !positioned ? ADDRESSING_UNKNOWN : (sh1106 ? ADDRESSING_PAGE : mode);
+        }
+
+        if (positioned && send(true, bytes, size))
+        {
+            positioned = !paged; // Window addressing runs on into the next page
+            for (uint8_t i = 0; m_shadow && i < pages; i++)
+            {
+                memcpy(sent(page + i) + band.leftcol, frame(page + i) + band.leftcol, segments);
+                if (segments == m_geometry.width)
+                    m_unsure &= ~(1 << (page + i));
+            }
+            return true;
+        }
+
+        m_errors.failures++;
+        positioned = false;
+    }
+
+    ESP_LOGW(TAG, "transfer - page %d failed after %d retries", page, RETRIES);
+    m_unsure |= ((1 << pages) - 1) << page; // Partly written
+    return false;
 }
 
 /**
- * @brief	Draw a horizontal line of the given color
- * @param   x   the starting x coord of the line
- * @param   y   the starting y coord of the line
- * @param   color   the color to set the segment bits
- * @param   w   the width of the line in pixels to draw
- * @param   h   the height of the line in pixels, defaults to 1
- * @return  True if line was drawn
+ * @brief   First GDDRAM column shown, which mirroring left to right moves to the other side
+ * @return  the column
  */
-bool SSD1306::horizontal(uint8_t x, uint8_t y, color_t color, uint8_t w, uint8_t h)
+uint8_t SSD1306::columnoffset()
 {
-    ESP_LOGD(TAG, "horizontal");
-    return box(x, y, color, w, h);
+    if (!(m_orientation & ORIENTATION_MIRROR_H))
+        return m_geometry.columnoffset;
+
+    uint8_t columns = m_geometry.controller == CONTROLLER_SH1106 ? 132 : COLUMNS;
+    return columns - m_geometry.width - m_geometry.columnoffset;
 }
 
 /**
- * @brief	Draw a vertical line of the given color
- * @param   x   the starting x coord of the line
- * @param   y   the starting y coord of the line
- * @param   color   the color to set the segment bits
- * @param   h   the height of the line in pixels to draw
- * @param   w   the width of the line in pixels, defaults to 1
- * @return  True if line was drawn
+ * @brief   A page of the frame last sent
+ * @param   page    The page
+ * @return  the page's bytes in the shadow
  */
-bool SSD1306::vertical(uint8_t x, uint8_t y, color_t color, uint8_t h, uint8_t w)
+uint8_t *SSD1306::sent(uint8_t page)
 {
-    ESP_LOGD(TAG, "vertical");
-    return box(x, y, color, w, h);
+    return m_shadow + page * m_geometry.width;
 }
 
 /**
- * @brief   Draw an aliased line
- *
- * @param   x       X coordinate or starting (top) point
- * @param   y       Y coordinate or starting (top) point
- * @param   color   Color of the line
- * @param   xx      X coordinate or ending (bottom) point
- * @param   yy      Y coordinate or ending (bottom) point
- * @return  Display - Fluent
+ * @brief   A page of the panel frame, the buffer or its transposition
+ * @param   page    The panel page
+ * @return  the page's bytes
  */
-void SSD1306::line(uint8_t x, uint8_t y, color_t color, uint8_t xx, uint8_t yy)
+uint8_t *SSD1306::frame(uint8_t page)
 {
-    ESP_LOGD(TAG, "line - %d,%d - %d,%d", x, y, xx, yy);
+    return m_transposed ? m_transposed + page * m_geometry.width : row(page);
+}
 
-    if (xx < x) // Ensure we're going left>right
+/**
+ * @brief   The 8x8 tiles of the transposed buffer covering a window
+ * 
+ * Page p, columns c to cc of one is pages c / 8 to cc / 8, columns 8p to 8p + 7 of the other, so
+ * this maps both ways, between the buffer and the panel frame.
+ * 
+ * @param   window  The window
+ * @return  the tiles' window
+ */
+Canvas::dirtywindow SSD1306::tiles(const dirtywindow &window)
+{
+    dirtywindow tiles;
+    uint16_t colstart, colend;
+    for (uint16_t page = window.toppage; page <= window.bottompage; page++)
     {
-        uint8_t tmp{x};
-        x = xx;
-        xx = tmp;
-        tmp = y;
-        y = yy;
-        yy = tmp;
+        if (window.span(page, colstart, colend))
+            tiles.touch(colstart / 8, colend / 8, page * 8, page * 8 + 7);
     }
+    return tiles;
+}
 
-    int dx{xx - x};
-    int dy{yy - y};
-    int ydelta{1};
-    if (yy < y)
+/**
+ * @brief   Transpose the tiles of a panel page span from the buffer into the panel frame
+ * 
+ * Panel tile (page, j) is buffer tile (page j, columns 8 * page to 8 * page + 7), transposed.
+ * 
+ * @param   page        The panel page
+ * @param   colstart    First panel column, a multiple of 8
+ * @param   colend      Last panel column
+ */
+void SSD1306::transpose(uint8_t page, uint16_t colstart, uint16_t colend)
+{
+    for (uint16_t tile = colstart / 8; tile <= colend / 8; tile++)
     {
-        dy = y - yy;
-        ydelta = -1;
+        transpose8(row(tile) + page * 8, m_transposed + page * m_geometry.width + tile * 8);
     }
+}
 
-    int p{2 * dy - dx};
-
-    do
+/**
+ * @brief   Send commands or data, timing the transfer to measure the transaction overhead
+ * 
+ * Short and long transfers are averaged separately; the overhead is where the line through
+ * the two averages meets zero time, in bytes.
+ * 
+ * @param   data    Data rather than commands
+ * @param   bytes   The bytes
+ * @param   size    Number of bytes
+ * @return  true if sent
+ */
+bool SSD1306::send(bool data, const uint8_t *bytes, uint8_t size)
+{
+    if (m_overhead_fixed || (size > 8 && size < 32))
+        return data ? m_pif->data(const_cast<uint8_t *>(bytes), size) : m_pif->command(bytes, size);
+
+    int64_t start = micros();
+    bool sent = data ? m_pif->data(const_cast<uint8_t *>(bytes), size) : m_pif->command(bytes, size);
+    if (!sent)
+        return sent;
+
+    uint32_t us = (micros() - start) * 16, length = size * 16;
+    uint32_t &averageus = size <= 8 ? m_short_us : m_long_us;
+    uint32_t &averagebytes = size <= 8 ? m_short_bytes : m_long_bytes;
+    if (averagebytes == 0)
     {
-        pixel(x, y, color);
+        averageus = us;
+        averagebytes = length;
+    }
+    averageus = averageus - averageus / 8 + us / 8;
+    averagebytes = averagebytes - averagebytes / 8 + length / 8;
 
-        p += (2 * dy);
-        if (p >= 0)
-        {
-            p -= (2 * dx);
-            y += ydelta;
-        }
-    } while ((x < m_width) && (x++ < xx));
+    if (m_short_bytes && m_long_bytes && m_long_us > m_short_us && m_long_bytes > m_short_bytes)
+    {
+        int64_t overhead = ((int64_t)m_short_us * m_long_bytes - (int64_t)m_long_us * m_short_bytes) /
+                           ((int64_t)(m_long_us - m_short_us) * 16);
+        m_overhead = std::max<int64_t>(1, std::min<int64_t>(64, overhead));
+    }
+    return sent;
 }
 
 /**
- * @brief   Set normal or inverted display
- * @param   invert      Invert display?
+ * @brief   Set the transaction overhead used to plan refreshes, instead of measuring it
+ * @param   bytes   Overhead in bus bytes, 0 to measure it again
  */
-void SSD1306::invert_display(bool invert)
+void SSD1306::transaction_overhead(uint8_t bytes)
 {
-    ESP_LOGD(TAG, "invert_display - invert: %d", invert);
-
-    if (invert)
-        m_pif->command(CMD_INVERTDISPLAY);
-    else
-        m_pif->command(CMD_NORMALDISPLAY);
+    m_overhead_fixed = bytes > 0;
+    m_overhead = bytes > 0 ? bytes : OVERHEAD;
+    m_short_us = m_short_bytes = m_long_us = m_long_bytes = 0;
 }
 
 /**
- * @brief   Direct update display buffer
- * @param   data        Data to fill display buffer, no length check is performed!
- * @param   length      Length of data
+ * @brief   Transaction overhead used to plan refreshes
+ * @return  the overhead in bus bytes: address, control byte, start and stop, and driver time
  */
-void SSD1306::update_buffer(uint8_t *data, uint16_t length)
+uint8_t SSD1306::transaction_overhead()
 {
-    ESP_LOGD(TAG, "update_buffer");
-    memcpy(m_buffer, data, min(length, m_buffer_bytes));
+    return m_overhead;
 }
@@ -0,0 +1,94 @@
+/*
+ ESP32-SSD1306-Driver Library Frame Statistics
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "Stats.h"
+
+#ifdef CONFIG_SSD1306_STATS
+
+#include <esp_log.h>
+#include <inttypes.h>
+#include <string.h>
+
+#if CONFIG_SSD1306_STATS_LOG_PERIOD > 0
+static const char *TAG = "Stats";
+#endif
+
+frame_stats_t ssd1306_stats{};
+thread_local uint8_t ssd1306_stats_raster_depth{0};
+
+#ifdef ESP_PLATFORM
+portMUX_TYPE ssd1306_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+#else
+std::mutex ssd1306_stats_lock;
+#endif
+
+/**
+ * @brief Zero the counters and timers
+ */
+void stats_reset()
+{
+    STATS_LOCK();
+    memset(&ssd1306_stats, 0, sizeof(ssd1306_stats));
+    STATS_UNLOCK();
+}
+
+/**
+ * @brief A consistent copy of the counters and timers
+ *
+ * @return the statistics
+ */
+frame_stats_t stats_snapshot()
+{
+    STATS_LOCK();
+    frame_stats_t stats = ssd1306_stats;
+    STATS_UNLOCK();
+    return stats;
+}
+
+/**
+ * @brief Count a refreshed frame, logging and resetting the statistics every log period
+ */
+void stats_frame()
+{
+    STATS_LOCK();
+    uint32_t frames = ++ssd1306_stats.frames;
+#if CONFIG_SSD1306_STATS_LOG_PERIOD > 0
+    frame_stats_t stats = ssd1306_stats;
+    if (frames >= CONFIG_SSD1306_STATS_LOG_PERIOD)
+        memset(&ssd1306_stats, 0, sizeof(ssd1306_stats));
+#endif
+    STATS_UNLOCK();
+
+#if CONFIG_SSD1306_STATS_LOG_PERIOD > 0
+    if (frames < CONFIG_SSD1306_STATS_LOG_PERIOD)
+        return;
+
+    /*
+     * Logged outside the lock, which on target is a critical section
+     */
+    ESP_LOGI(TAG,
+             "%u frames, per frame: draw %" PRIu64 ", buffer %" PRIu64 ", refresh %" PRIu64 ", bus %" PRIu64
+             " " STATS_UNIT "; %u bytes, %u transactions, %u pixels refreshed, %u glyphs",
+             frames, stats.draw / frames, stats.buffer / frames, stats.refresh / frames, stats.bus / frames,
+             stats.bytes / frames, stats.transactions / frames, stats.dirty / frames, stats.glyphs / frames);
+#else
+    (void)frames;
+#endif
+}
+
+#endif /* CONFIG_SSD1306_STATS */
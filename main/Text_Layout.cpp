@@ -0,0 +1,227 @@
+/*
+ ESP32-SSD1306-Driver Library Text Layout
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include "Text_Layout.h"
+
+#include <algorithm>
+
+using std::min;
+
+/**
+ * @brief Lay out text in a box, from the memo when the text has been laid out there before
+ *
+ * @param font the font
+ * @param text the text, paragraphs separated by newlines
+ * @param width box width
+ * @param height box height
+ * @param flags layout flags
+ * @return the layout, valid until the memo entry is replaced
+ */
+const Text_Layout::layout_t &Text_Layout::layout(Font_Manager &font, const std::string &text, uint16_t width,
+                                                 uint16_t height, uint8_t flags)
+{
+    const char *name = font.font_name();
+    uint16_t size = min<size_t>(text.size(), UINT16_MAX);
+
+    for (uint8_t e = 0; size <= TEXT && e < ENTRIES; e++)
+    {
+        layout_t &entry = m_entries[e];
+        if (entry.font != nullptr && entry.font == name && entry.size == size && entry.width == width &&
+            entry.height == height && entry.flags == flags && !memcmp(entry.text, text.data(), size))
+        {
+            hits++;
+            return entry;
+        }
+    }
+
+    misses++;
+    layout_t &entry = m_entries[m_next];
+    m_next = (m_next + 1) % ENTRIES;
+
+    entry.font = size <= TEXT ? name : nullptr; // Too long to compare, never found
+    entry.size = size;
+    entry.width = width;
+    entry.height = height;
+    entry.flags = flags;
+    if (size <= TEXT)
+        memcpy(entry.text, text.data(), size);
+    compute(font, text, entry);
+    return entry;
+}
+
+/**
+ * @brief Left of a line aligned in the box
+ *
+ * @param line the line
+ * @param width box width
+ * @param align the alignment
+ * @return the line left, relative to the box left
+ */
+uint16_t Text_Layout::left(const line_t &line, uint16_t width, align_t align)
+{
+    if (line.width >= width || align == ALIGN_LEFT)
+        return 0;
+    if (align == ALIGN_CENTER)
+        return (width - line.width) / 2;
+    return width - line.width;
+}
+
+/**
+ * @brief Break text into the lines that fit the layout's box
+ *
+ * Greedy: each line takes as many characters as fit, then with LAYOUT_WRAP gives back those
+ * after its last space, or breaks within a word that has no space before it. Spaces at a break
+ * are dropped. Without LAYOUT_WRAP the rest of a paragraph that does not fit is cut off.
+ *
+ * @param font the font
+ * @param text the text
+ * @param layout the layout, its key set
+ */
+void Text_Layout::compute(Font_Manager &font, const std::string &text, layout_t &layout)
+{
+    uint8_t height = font.font_height();
+    uint8_t most{0}; // Lines that fit the box height
+    if (layout.height >= height)
+        most = min<uint16_t>((layout.height - height) / (height + 1) + 1, (uint16_t)LINES);
+    uint16_t n = layout.size;
+    uint16_t pos{0};
+    bool cut{false}; // Text left over
+
+    layout.pitch = height + 1;
+    layout.count = 0;
+
+    while (pos < n)
+    {
+        if (layout.count == most)
+        {
+            cut = true;
+            break;
+        }
+
+        line_t &line = layout.lines[layout.count++];
+        line.start = pos;
+        line.ellipsis = false;
+
+        uint16_t end = pos;
+        uint16_t width{0};
+        uint16_t space{0};      // Position of the last space that follows a character
+        uint16_t spacewidth{0}; // Width of the line before that space
+        bool full{false};
+
+        while (end < n && text[end] != '\n')
+        {
+            uint8_t w = font.char_width(text[end]);
+            if (width + w > layout.width)
+            {
+                full = true;
+                break;
+            }
+            if (text[end] == ' ' && end > pos && text[end - 1] != ' ')
+            {
+                space = end;
+                spacewidth = width;
+            }
+            width += w;
+            end++;
+        }
+
+        if (!full)
+        /*
+         * The paragraph ends on this line
+         */
+        {
+            line.length = end - pos;
+            line.width = width;
+            pos = end + 1;
+            continue;
+        }
+
+        if (!(layout.flags & LAYOUT_WRAP))
+        /*
+         * Cut off the rest of the paragraph
+         */
+        {
+            line.length = end - pos;
+            line.width = width;
+            if (layout.flags & LAYOUT_ELLIPSIS)
+                ellipsize(font, text, layout.width, line);
+            while (end < n && text[end] != '\n')
+            {
+                end++;
+            }
+            pos = end + 1;
+            continue;
+        }
+
+        if (space > pos)
+        /*
+         * Break at the last space
+         */
+        {
+            end = space;
+            width = spacewidth;
+        }
+        else if (end == pos)
+        /*
+         * A character wider than the box still takes a line
+         */
+        {
+            width = font.char_width(text[end++]);
+        }
+
+        line.length = end - pos;
+        line.width = width;
+
+        while (end < n && text[end] == ' ')
+        {
+            end++;
+        }
+        if (end < n && text[end] == '\n')
+            end++;
+        pos = end;
+    }
+
+    if (cut && layout.count && (layout.flags & LAYOUT_ELLIPSIS))
+        ellipsize(font, text, layout.width, layout.lines[layout.count - 1]);
+}
+
+/**
+ * @brief Shorten a line until "..." fits after it
+ *
+ * @param font the font
+ * @param text the text
+ * @param width box width
+ * @param line the line
+ */
+void Text_Layout::ellipsize(Font_Manager &font, const std::string &text, uint16_t width, line_t &line)
+{
+    if (line.ellipsis)
+        return;
+
+    uint16_t dots = 3 * font.char_width('.');
+    if (dots > width)
+        return;
+
+    while (line.length && (line.width + dots > width || text[line.start + line.length - 1] == ' '))
+    {
+        line.length--;
+        line.width -= font.char_width(text[line.start + line.length]);
+    }
+    line.width += dots;
+    line.ellipsis = true;
+}
@@ -63,12 +63,12 @@ void app_main()
     //SPI_PIF spi { mosi, clk, cs, dc };
 #endif
 
-    SSD1306 ssd1306(pif, SSD1306_128x64);
+    SSD1306_Panel<128, 64> ssd1306(pif);
     OLED display = OLED(ssd1306);
 
     while (true)
     {
-    //     for (int i = 0; i < 27; i++)
+    //     for (int i = 0; i < Font_Manager::fontcount(); i++)
     //     {
     //         display.select_font(i).clear();                               //
     //         display.draw_string(0, 0, display.font_name(), WHITE, BLACK); //
@@ -0,0 +1,241 @@
+/*
+ ESP32-SSD1306-Driver Library Canvas
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_CANVAS_H_
+#define SSD1306_CANVAS_H_
+
+#include <esp_log.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <string.h>
+#include <stdint.h>
+
+#include <Font_Manager.h>
+
+/**
+ * @brief Color options supported by the SSD1306
+ *
+ */
+enum color_t
+{
+    TRANSPARENT = -1, ///< Transparent (not drawing)
+    BLACK = 0,        ///< Black (pixel off)
+    WHITE = 1,        ///< White (or blue, yellow, pixel on)
+    INVERT = 2,       ///< Invert pixel (XOR)
+};
+
+/**
+ * @brief Raster operation combining image bits with the display buffer
+ *
+ */
+enum rop_t
+{
+    ROP_COPY, ///< Image replaces the buffer
+    ROP_OR,   ///< Image set bits are turned on
+    ROP_AND,  ///< Image clear bits are turned off
+    ROP_XOR,  ///< Image set bits are inverted
+};
+
+/**
+ * @brief Text style flags, combined with |
+ *
+ */
+enum text_style_t
+{
+    STYLE_NORMAL = 0,    ///< As the font draws it
+    STYLE_BOLD = 1,      ///< Each column ORed with the one before, a pixel wider
+    STYLE_UNDERLINE = 2, ///< A line along the bottom row
+    STYLE_STRIKE = 4,    ///< A line through the middle row
+    STYLE_INVERSE = 8,   ///< Characters cut out of a box of the text color
+};
+
+/**
+ * @brief Image bitmap layout
+ *
+ */
+enum image_format_t
+{
+    IMAGE_TBLR, ///< Page format: bytes of 8 vertical pixels, LSB on top, page by page
+    IMAGE_LRTB, ///< Row format: bytes of 8 horizontal pixels, MSB on left, row by row
+};
+
+/**
+ * @brief An image or sprite, with an optional mask plane of the same format
+ *
+ * Where the mask is given only image pixels with their mask bit set are drawn.
+ */
+struct image_t
+{
+    uint16_t width;        ///< Width in pixels
+    uint16_t height;       ///< Height in pixels
+    image_format_t format; ///< Layout of bitmap and mask
+    const uint8_t *bitmap; ///< Image bits
+    const uint8_t *mask;   ///< Optional mask bits, nullptr for none
+};
+
+/**
+ * @brief Drawing surface over a page-packed buffer
+ *
+ * The buffer is laid out as the SSD1306 memory: pages of 8 pixel rows, each page a run of
+ * column bytes with the LSB on top. A canvas can be any size; the SSD1306 driver is itself
+ * a canvas over the panel buffer, and off-screen canvases can be composited onto it with blit.
+ */
+class Canvas
+{
+    static const constexpr char *TAG = "Canvas";
+
+public:
+    static const constexpr uint16_t MAX_HEIGHT = 255 * 8; ///< Tallest canvas, its pages are indexed by a byte
+
+    Canvas(uint16_t width, uint16_t height);
+    Canvas(uint8_t *buffer, uint16_t width, uint16_t height);
+    Canvas(const Canvas &) = delete;
+    Canvas &operator=(const Canvas &) = delete;
+
+    virtual ~Canvas();
+
+    uint16_t width();
+    uint16_t height();
+    uint8_t *buffer();
+    image_t image();
+    void clear();
+    bool segment(uint8_t page, uint16_t column, uint8_t bits, color_t color, uint16_t count = 1);
+    bool pixel(uint16_t x, uint16_t y, color_t color);
+    bool box(uint16_t x, uint16_t y, color_t color, uint16_t w, uint16_t h);
+    bool horizontal(uint16_t x, uint16_t y, color_t color, uint16_t w, uint16_t h = 1);
+    bool vertical(uint16_t x, uint16_t y, color_t color, uint16_t h, uint16_t w = 1);
+    void line(uint16_t x, uint16_t y, color_t color, uint16_t xx, uint16_t yy);
+    void polyline(const uint8_t *xs, const uint8_t *ys, uint8_t count, color_t color);
+    void sparkline(uint16_t x, const uint8_t *ys, uint8_t count, color_t color);
+    bool blit(int16_t x, int16_t y, const image_t &image, rop_t rop = ROP_OR);
+    bool scroll(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t n);
+    uint16_t text(uint16_t x, uint16_t y, Font_Manager &font, const std::string &str, color_t color,
+                  color_t background = TRANSPARENT, uint8_t style = STYLE_NORMAL);
+    uint16_t text(uint16_t x, uint16_t y, Font_Manager &font, const char *str, uint16_t length, color_t color,
+                  color_t background = TRANSPARENT, uint8_t style = STYLE_NORMAL);
+    uint16_t text(uint16_t x, uint16_t y, Font_Manager &font, unsigned char c, color_t color,
+                  color_t background = TRANSPARENT, uint8_t style = STYLE_NORMAL);
+    uint16_t text_vertical(uint16_t x, uint16_t y, Font_Manager &font, const std::string &str, color_t color,
+                           color_t background = TRANSPARENT);
+    uint16_t text_scaled(uint16_t x, uint16_t y, Font_Manager &font, const std::string &str, uint8_t scale,
+                         color_t color, color_t background = TRANSPARENT, uint8_t style = STYLE_NORMAL);
+
+protected:
+    const uint8_t BITS[8] = {0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF}; ///< Segment bit mask
+
+    uint8_t *m_buffer;       ///< Page-packed buffer - Page by Column
+    bool m_owner;            ///< Buffer allocated by this canvas
+    uint16_t m_width;        ///< Width in pixels, columns per page
+    uint16_t m_height;       ///< Height in pixels
+    uint8_t m_pages;         ///< Number of pages
+    uint32_t m_buffer_bytes; ///< buffer size in bytes
+
+    struct dirtywindow ///< "Dirty" window, with the column span of each page
+    {
+        static const constexpr uint8_t SPANS = 16; ///< Pages with their own span, beyond take the window's
+
+        bool isdirty{false};
+        uint8_t toppage{255};
+        uint16_t leftcol{0xFFFF};
+        uint16_t rightcol{0};
+        uint8_t bottompage{0};
+        uint16_t spanleft[SPANS];  ///< First dirty column of each page
+        uint16_t spanright[SPANS]; ///< Last dirty column of each page, before spanleft if clean
+
+        dirtywindow()
+        {
+            clear();
+        }
+
+        void clear() ///< Clear the dirty window
+        {
+            toppage = 255;
+            leftcol = 0xFFFF;
+            rightcol = 0;
+            bottompage = 0;
+            isdirty = false;
+            for (uint8_t page = 0; page < SPANS; page++)
+            {
+                spanleft[page] = 0xFFFF;
+                spanright[page] = 0;
+            }
+        }
+
+        void touch(uint8_t page, uint16_t colstart, uint16_t colend = 0) ///< Touch part of the window
+        {
+            toppage = std::min(toppage, page);
+            bottompage = std::max(bottompage, page);
+            leftcol = std::min(leftcol, colstart);
+            rightcol = std::max(rightcol, colend);
+            isdirty = true;
+            if (page < SPANS)
+            {
+                spanleft[page] = std::min(spanleft[page], colstart);
+                spanright[page] = std::max(spanright[page], std::max(colstart, colend));
+            }
+        }
+
+        void touch(uint8_t top, uint8_t bottom, uint16_t colstart, uint16_t colend) ///< Touch a box of pages
+        {
+            for (uint16_t page = top; page <= bottom; page++)
+            {
+                touch(page, colstart, colend);
+            }
+        }
+
+        bool span(uint8_t page, uint16_t &colstart, uint16_t &colend) const ///< The dirty columns of a page
+        {
+            if (!isdirty || page < toppage || page > bottompage)
+                return false;
+            colstart = page < SPANS ? spanleft[page] : leftcol;
+            colend = page < SPANS ? spanright[page] : rightcol;
+            return colstart <= colend;
+        }
+    } m_dirtywindow;
+
+    uint8_t *row(uint8_t page);
+    void touch();
+    void touch(const dirtywindow &extent);
+
+private:
+    struct ink ///< A color as the segment bits it turns on, off and inverts
+    {
+        uint8_t on;
+        uint8_t off;
+        uint8_t flip;
+
+        ink(color_t color)
+            : on(color == WHITE ? 0xFF : 0), off(color == BLACK ? 0xFF : 0), flip(color == INVERT ? 0xFF : 0)
+        {
+        }
+    };
+
+    void write(uint8_t page, uint16_t column, uint8_t bits, color_t color);
+    void write(uint8_t page, uint16_t column, uint8_t bits, uint8_t mask, const ink &foreground, const ink &background);
+    void stroke(int x, int y, int xx, int yy, color_t color, bool skipfirst, dirtywindow &extent);
+    void combine(uint8_t page, uint16_t column, uint8_t bits, uint8_t mask, rop_t rop);
+    uint8_t fetch(const image_t &image, const uint8_t *plane, uint16_t page, uint16_t column);
+    uint16_t place(uint16_t x, uint16_t y, Font_Manager::bitmap &scan, color_t color, color_t background,
+                   uint8_t style, uint8_t gap = 0);
+    uint8_t lines(const Font_Manager::bitmap &scan, uint16_t page, uint8_t style);
+    uint8_t styled(uint8_t bits, uint8_t previous, uint8_t lines, uint8_t mask, uint8_t style);
+};
+
+#endif /* SSD1306_CANVAS_H_ */
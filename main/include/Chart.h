@@ -0,0 +1,89 @@
+/*
+ ESP32-SSD1306-Driver Library Chart
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_CHART_H_
+#define SSD1306_CHART_H_
+
+#include <stdint.h>
+
+#include "Canvas.h"
+
+/**
+ * @brief Scrolling time-series chart
+ *
+ * Samples are kept in a ring buffer holding one entry per plotted column. When a new column
+ * completes, the plot area is scrolled left one column and only the new segment is drawn, so
+ * the per-sample cost follows the plot height rather than its area. If auto-scaling changes the
+ * range the whole plot is redrawn.
+ */
+class Chart
+{
+public:
+    /**
+     * @brief How samples are combined into a column when decimating
+     *
+     */
+    enum Decimation
+    {
+        AVERAGE, ///< Plot the mean of the column samples as a line
+        MINMAX,  ///< Plot the min-max envelope of the column samples
+    };
+
+    Chart(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t decimate = 1, Decimation mode = AVERAGE);
+
+    Chart(const Chart &) = delete;
+    Chart &operator=(const Chart &) = delete;
+
+    virtual ~Chart();
+
+    void range(int16_t min, int16_t max);
+    void autoscale();
+    bool push(int16_t sample);
+    void append(Canvas &canvas, color_t color);
+    void redraw(Canvas &canvas, color_t color);
+    uint8_t count();
+
+private:
+    uint8_t m_x;            ///< Plot area left
+    uint8_t m_y;            ///< Plot area top
+    uint8_t m_w;            ///< Plot area width, one column per entry
+    uint8_t m_h;            ///< Plot area height
+    uint8_t m_decimate;     ///< Samples per column
+    Decimation m_mode;      ///< Column decimation
+    bool m_autoscale{true}; ///< Track the min/max of the plotted samples
+    int16_t m_min{0};       ///< Bottom of the plot range
+    int16_t m_max{0};       ///< Top of the plot range
+
+    int16_t *m_lo; ///< Column low values, ring buffer
+    int16_t *m_hi; ///< Column high values, ring buffer
+    uint8_t m_head{0};  ///< Index of the oldest column
+    uint8_t m_count{0}; ///< Number of columns held
+
+    int32_t m_sum{0};       ///< Accumulating column sum
+    int16_t m_acclo{0};     ///< Accumulating column low
+    int16_t m_acchi{0};     ///< Accumulating column high
+    uint8_t m_accn{0};      ///< Accumulating column sample count
+    bool m_rescaled{false}; ///< Range changed since last draw
+
+    uint8_t index(uint8_t column);
+    bool rescale();
+    uint8_t scale(int16_t value);
+    void draw(Canvas &canvas, uint8_t column, color_t color);
+};
+
+#endif /* SSD1306_CHART_H_ */
@@ -116,6 +116,28 @@ public:
          */
         virtual Display &draw_line(uint8_t x, uint8_t y, uint8_t xx, uint8_t yy, color_t color) = 0;
 
+        /**
+         * @brief   Draw connected aliased lines through a set of points
+         * 
+         * @param   xs      X coordinates of the points
+         * @param   ys      Y coordinates of the points
+         * @param   count   Number of points
+         * @param   color   Color of the lines
+         * @return  Display& - Fluent
+         */
+        virtual Display &draw_polyline(const uint8_t *xs, const uint8_t *ys, uint8_t count, color_t color) = 0;
+
+        /**
+         * @brief   Draw a sparkline, connected points on consecutive columns
+         * 
+         * @param   x       X coordinate of the first point
+         * @param   ys      Y coordinates of the points
+         * @param   count   Number of points
+         * @param   color   Color of the lines
+         * @return  Display& - Fluent
+         */
+        virtual Display &draw_sparkline(uint8_t x, const uint8_t *ys, uint8_t count, color_t color) = 0;
+
         /**
          * @brief   Draw a rectangle
          * 
@@ -162,6 +184,17 @@ public:
          */
         virtual Display &fill_circle(uint8_t x, uint8_t y, uint8_t r, color_t color) = 0;
 
+        /**
+         * @brief   Draw an image or sprite
+         * 
+         * @param   x       X coordinate of the image left, may be negative
+         * @param   y       Y coordinate of the image top, may be negative
+         * @param   image   The image, with optional mask
+         * @param   rop     How the image is combined with the display
+         * @return  Display& - Fluent
+         */
+        virtual Display &draw_image(int16_t x, int16_t y, const image_t &image, rop_t rop = ROP_OR) = 0;
+
         /**
          * @brief   Draw one character using currently selected font
          * 
@@ -169,7 +202,7 @@ public:
          * @param   y           Y position of character (top-left corner)
          * @param   c           The character to draw
          * @param   foreground  Character color
-         * @param   background  Background color
+         * @param   background  Background color, or TRANSPARENT to draw only the characters
          * @param   outwidth  Width of the character
          * @return  Display& - Fluent
          */
@@ -183,7 +216,7 @@ public:
          * @param   y           Y position of string (top-left corner)
          * @param   str         The string to draw
          * @param   foreground  Character color
-         * @param   background  Background color
+         * @param   background  Background color, or TRANSPARENT to draw only the characters
          * @param   outwidth  Width of the string (out-of-display pixels also included)
          * @return  Display& - Fluent
          */
@@ -0,0 +1,287 @@
+/*
+ ESP32-SSD1306-Driver Library I2C Bus
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_I2C_BUS_H_
+#define SSD1306_I2C_BUS_H_
+
+#include <stdint.h>
+
+#include <driver/i2c.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+/**
+ * @brief An I2C port shared between the display and other devices
+ *
+ * Each user locks the bus around its transactions. The lock is a FreeRTOS mutex, so waiting
+ * tasks take the bus in priority order and a low priority holder inherits the priority of a
+ * high priority waiter. The display locks per page, or per chunk, and yields in between, so a
+ * sensor task of higher priority than the display waits for at most one display transaction.
+ *
+ * The worst wait seen by the other devices, and the longest display transaction, are recorded.
+ */
+class I2C_Bus
+{
+    private:
+
+        i2c_port_t m_port;
+        bool m_owner;    ///< Driver installed by this bus
+        SemaphoreHandle_t m_mutex;
+
+        bool m_display { false };         ///< Holder is the display
+        int64_t m_locked { 0 };           ///< Time the bus was locked
+        uint32_t m_worst_wait_us { 0 };   ///< Longest wait by a device other than the display
+        uint32_t m_worst_hold_us { 0 };   ///< Longest display transaction
+        uint32_t m_contended { 0 };       ///< Device locks that had to wait
+
+        /**
+         * @brief Number of users of each port's driver
+         * @param port the I2C port
+         * @return reference to the port's user count
+         */
+        static uint8_t& users( i2c_port_t port )
+        {
+            static uint8_t count[I2C_NUM_MAX] { 0 };
+            return count[port];
+        }
+
+        /**
+         * @brief Configuration of each port's driver, as installed
+         * @param port the I2C port
+         * @return reference to the port's configuration
+         */
+        static i2c_config_t& config( i2c_port_t port )
+        {
+            static i2c_config_t conf[I2C_NUM_MAX] { };
+            return conf[port];
+        }
+
+    public:
+
+        /**
+         * @brief Install the driver on a port, unless another user already has
+         * @param port the I2C port
+         * @param scl
+         * @param sda
+         * @param speed bus clock in Hz
+         */
+        static void install( i2c_port_t port, gpio_num_t scl, gpio_num_t sda, uint32_t speed )
+        {
+            if ( users( port )++ > 0 )
+            {
+                return;
+            }
+
+            i2c_config_t& conf = config( port );
+            conf.mode = I2C_MODE_MASTER;
+            conf.sda_io_num = sda;
+            conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
+            conf.scl_io_num = scl;
+            conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
+            conf.master.clk_speed = speed;
+
+            ESP_ERROR_CHECK( i2c_param_config( port, &conf ) );
+            ESP_ERROR_CHECK( i2c_driver_install( port, I2C_MODE_MASTER, 0, 0, 0 ) );
+        }
+
+        /**
+         * @brief Change the clock of a port installed here
+         * @param port the I2C port
+         * @param speed bus clock in Hz
+         * @return false if the driver was not installed here, or the clock not accepted
+         */
+        static bool speed( i2c_port_t port, uint32_t speed )
+        {
+            if ( users( port ) == 0 )
+            {
+                return false;
+            }
+
+            config( port ).master.clk_speed = speed;
+            return i2c_param_config( port, &config( port ) ) == ESP_OK;
+        }
+
+        /**
+         * @brief The clock of a port installed here
+         * @param port the I2C port
+         * @return bus clock in Hz, 0 if the driver was not installed here
+         */
+        static uint32_t speed( i2c_port_t port )
+        {
+            return users( port ) > 0 ? config( port ).master.clk_speed : 0;
+        }
+
+        /**
+         * @brief Release a port's driver, deleting it with its last user
+         * @param port the I2C port
+         */
+        static void release( i2c_port_t port )
+        {
+            if ( --users( port ) == 0 )
+            {
+                i2c_driver_delete( port );
+            }
+        }
+
+        /**
+         * Installs the port driver
+         *
+         * @param scl
+         * @param sda
+         * @param port the I2C port
+         * @param speed bus clock in Hz
+         */
+        I2C_Bus( gpio_num_t scl, gpio_num_t sda, i2c_port_t port = I2C_NUM_0, uint32_t speed = 400000 ) :
+                m_port { port }, m_owner { true }
+        {
+            install( port, scl, sda, speed );
+            m_mutex = xSemaphoreCreateMutex();
+        }
+
+        /**
+         * Uses a port whose driver the application has already installed
+         *
+         * @param port the I2C port
+         */
+        I2C_Bus( i2c_port_t port ) :
+                m_port { port }, m_owner { false }
+        {
+            m_mutex = xSemaphoreCreateMutex();
+        }
+
+        virtual ~I2C_Bus()
+        {
+            vSemaphoreDelete( m_mutex );
+            if ( m_owner )
+            {
+                release( m_port );
+            }
+        }
+
+        /**
+         * @brief The I2C port
+         */
+        i2c_port_t port()
+        {
+            return m_port;
+        }
+
+        /**
+         * @brief Lock the bus for a transaction
+         * @param timeout ticks to wait
+         * @param display the display is locking the bus
+         * @return true if locked
+         */
+        bool lock( TickType_t timeout = portMAX_DELAY, bool display = false )
+        {
+            if ( xSemaphoreTake( m_mutex, 0 ) != pdTRUE )
+            {
+                int64_t start = esp_timer_get_time();
+                if ( xSemaphoreTake( m_mutex, timeout ) != pdTRUE )
+                {
+                    return false;
+                }
+
+                uint32_t wait = esp_timer_get_time() - start;
+                if ( !display )
+                {
+                    m_contended++;
+                    if ( wait > m_worst_wait_us )
+                    {
+                        m_worst_wait_us = wait;
+                    }
+                }
+            }
+            m_locked = esp_timer_get_time();
+            m_display = display;
+            return true;
+        }
+
+        /**
+         * @brief Unlock the bus
+         */
+        void unlock()
+        {
+            if ( m_display )
+            {
+                uint32_t hold = esp_timer_get_time() - m_locked;
+                if ( hold > m_worst_hold_us )
+                {
+                    m_worst_hold_us = hold;
+                }
+            }
+            xSemaphoreGive( m_mutex );
+        }
+
+        /**
+         * @brief Run a command link under the bus lock
+         * @param cmd the command link
+         * @param timeout ticks to wait for the bus and then the transaction
+         * @return the driver result, or ESP_ERR_TIMEOUT if the bus was not free
+         */
+        esp_err_t transact( i2c_cmd_handle_t cmd, TickType_t timeout )
+        {
+            if ( !lock( timeout ) )
+            {
+                return ESP_ERR_TIMEOUT;
+            }
+            esp_err_t ret = i2c_master_cmd_begin( m_port, cmd, timeout );
+            unlock();
+            return ret;
+        }
+
+        /**
+         * @brief Worst case latency added to other devices by bus traffic
+         * @return the longest wait for the bus by a device other than the display, microseconds
+         */
+        uint32_t worst_wait_us()
+        {
+            return m_worst_wait_us;
+        }
+
+        /**
+         * @brief Longest display transaction, the bound on the latency added to a higher priority task
+         * @return the longest display hold of the bus, microseconds
+         */
+        uint32_t worst_hold_us()
+        {
+            return m_worst_hold_us;
+        }
+
+        /**
+         * @brief Number of device locks that waited for the bus
+         */
+        uint32_t contended()
+        {
+            return m_contended;
+        }
+
+        /**
+         * @brief Reset the latency statistics
+         */
+        void reset_stats()
+        {
+            m_worst_wait_us = 0;
+            m_worst_hold_us = 0;
+            m_contended = 0;
+        }
+};
+
+#endif  // SSD1306_I2C_BUS_H_
@@ -20,10 +20,16 @@
 #define SSD1306_I2C_PIF_H_
 
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 #include <driver/i2c.h>
+#include <esp_log.h>
+#include <nvs.h>
 
+#include "I2C_Bus.h"
 #include "PIF.h"
+#include "Stats.h"
 
 /**
  * @brief I2C implementation of PIF 
@@ -31,23 +37,49 @@
  */
 class I2C_PIF : public PIF
 {
-        static const constexpr int BUSSPEEDHZ = 1000000;
+        static const constexpr char *TAG = "I2C_PIF";
+        static const constexpr int BUSSPEEDHZ = 400000;    ///< SSD1306 specified clock
+        static const constexpr char *NVS_NAMESPACE = "ssd1306";
 
     private:
 
-        i2c_port_t i2c_master_port = I2C_NUM_0;
+        i2c_port_t i2c_master_port;
         gpio_num_t m_scl;
         gpio_num_t m_sda;
         uint8_t m_address_read;
         uint8_t m_address_write;
         i2c_cmd_handle_t cmdlink { NULL };
+        I2C_Bus* m_bus { nullptr };    ///< Shared bus, if any
+        uint8_t m_chunk { 0 };         ///< Most data bytes per bus lock, 0 for no limit
+
+        /**
+         * @brief Run a command link, under the bus lock if the bus is shared
+         * @param cmdlink
+         * @return the driver result
+         */
+        esp_err_t begin( i2c_cmd_handle_t cmdlink )
+        {
+            STATS_TIME( bus );
+            STATS_ADD( transactions, 1 );
+
+            if ( m_bus == nullptr )
+            {
+                return i2c_master_cmd_begin( i2c_master_port, cmdlink, 50 / portTICK_RATE_MS );
+            }
+
+            m_bus->lock( portMAX_DELAY, true );
+            esp_err_t ret = i2c_master_cmd_begin( i2c_master_port, cmdlink, 50 / portTICK_RATE_MS );
+            m_bus->unlock();
+            taskYIELD();    // Let a waiting device of the same priority have the bus
+            return ret;
+        }
 
         /**
          * @brief
          * @param ctrl
          * @param data
          */
-        void write(const uint8_t ctrl, const uint8_t data )
+        esp_err_t write(const uint8_t ctrl, const uint8_t data )
         {
             i2c_cmd_handle_t cmdlink = i2c_cmd_link_create();
             i2c_master_start( cmdlink );
@@ -55,8 +87,10 @@ class I2C_PIF : public PIF
             i2c_master_write_byte( cmdlink, ctrl, 1 );
             i2c_master_write_byte( cmdlink, data, 1 );
             i2c_master_stop( cmdlink );
-            i2c_master_cmd_begin( i2c_master_port, cmdlink, 50 / portTICK_RATE_MS );
+            STATS_ADD( bytes, 3 );
+            esp_err_t ret = begin( cmdlink );
             i2c_cmd_link_delete( cmdlink );
+            return ret;
         }
 
         /**
@@ -65,7 +99,7 @@ class I2C_PIF : public PIF
          * @param data
          * @param size
          */
-        void write(const uint8_t ctrl, const uint8_t* data, uint8_t size )
+        esp_err_t write(const uint8_t ctrl, const uint8_t* data, uint8_t size )
         {
             uint8_t* d =  (uint8_t*)data;
             i2c_cmd_handle_t cmdlink = i2c_cmd_link_create();
@@ -74,59 +108,100 @@ class I2C_PIF : public PIF
             i2c_master_write_byte( cmdlink, ctrl, 1 );
             i2c_master_write( cmdlink, d, size, 1 );
             i2c_master_stop( cmdlink );
-            i2c_master_cmd_begin( i2c_master_port, cmdlink, 50 / portTICK_RATE_MS );
+            STATS_ADD( bytes, 2 + size );
+            esp_err_t ret = begin( cmdlink );
             i2c_cmd_link_delete( cmdlink );
+            return ret;
+        }
+
+        /**
+         * @brief Write test patterns to GDDRAM page 0, reading back the status byte after each
+         * @param rounds number of pattern writes
+         * @param expected the status byte read at a safe clock
+         * @return number of failed transactions and status mismatches
+         */
+        uint16_t probe( uint8_t rounds, uint8_t expected )
+        {
+            const uint8_t window[] = { 0x21, 0, 127, 0x22, 0, 0 };    // Column 0-127, page 0
+            uint8_t pattern[128];
+            uint16_t errors { 0 };
+
+            for ( uint8_t r = 0; r < rounds; r++ )
+            {
+                memset( pattern, ( r & 1 ) ? 0xaa : 0x55, sizeof ( pattern ) );
+                uint8_t status;
+                errors += write( 0x00, window, sizeof ( window ) ) != ESP_OK;
+                errors += write( 0x40, pattern, sizeof ( pattern ) ) != ESP_OK;
+                errors += read_status( status ) != ESP_OK || status != expected;
+            }
+            return errors;
         }
 
     public:
 
         /**
+         * Panels at different addresses on the same port share the port's driver, which is
+         * installed by the first I2C_PIF on the port and deleted with the last.
          *
          * @param scl
          * @param sda
          * @param address
+         * @param port the I2C port
+         * @param speed bus clock in Hz, for the first panel on the port
          */
-        I2C_PIF( gpio_num_t scl, gpio_num_t sda, uint8_t address ) :
-                m_scl { scl }, m_sda { sda }
+        I2C_PIF( gpio_num_t scl, gpio_num_t sda, uint8_t address, i2c_port_t port = I2C_NUM_0,
+                uint32_t speed = BUSSPEEDHZ ) :
+                i2c_master_port { port }, m_scl { scl }, m_sda { sda }
         {
             m_address_read = ( address << 1 ) | I2C_MASTER_READ;
             m_address_write = ( address << 1 ) | I2C_MASTER_WRITE;
-            i2c_config_t conf;
-            conf.mode = I2C_MODE_MASTER;
-            conf.sda_io_num = sda;
-            conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
-            conf.scl_io_num = scl;
-            conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
-            conf.master.clk_speed = BUSSPEEDHZ;
-
-            ESP_ERROR_CHECK( i2c_param_config( i2c_master_port, &conf ) );
-            ESP_ERROR_CHECK( i2c_driver_install( i2c_master_port, I2C_MODE_MASTER, 0, 0, 0 ) );
+            I2C_Bus::install( i2c_master_port, scl, sda, speed );
+        }
 
+        /**
+         * The panel shares the bus with other devices, locking it per transaction. Data is
+         * sent in chunks of at most chunk bytes, so other devices wait for at most one chunk.
+         *
+         * @param bus the shared bus
+         * @param address
+         * @param chunk most data bytes per transaction, 0 to send each driver transfer in one; the
+         *        driver merges narrow pages into bursts, so that waits for up to 255 bytes
+         */
+        I2C_PIF( I2C_Bus& bus, uint8_t address, uint8_t chunk = 0 ) :
+                i2c_master_port { bus.port() }, m_scl { GPIO_NUM_NC }, m_sda { GPIO_NUM_NC },
+                m_bus { &bus }, m_chunk { chunk }
+        {
+            m_address_read = ( address << 1 ) | I2C_MASTER_READ;
+            m_address_write = ( address << 1 ) | I2C_MASTER_WRITE;
         }
 
         virtual ~I2C_PIF()
         {
             i2c_cmd_link_delete( cmdlink );
+            if ( m_bus == nullptr )
+            {
+                I2C_Bus::release( i2c_master_port );
+            }
         }
 
         /**
          *
          * @param cmd
          */
-        void command(const uint8_t cmd )
+        bool command(const uint8_t cmd )
         {
-            write( 0x00, cmd );
+            return write( 0x00, cmd ) == ESP_OK;
         }
 
-        void command(const uint8_t* cmd, uint8_t size )
+        bool command(const uint8_t* cmd, uint8_t size )
         {
             if ( size > 0 )
             {
-                write( 0x00, cmd, size );
+                return write( 0x00, cmd, size ) == ESP_OK;
             }
             else
             {
-                write( 0x00, cmd, sizeof ( cmd ) );
+                return write( 0x00, cmd, sizeof ( cmd ) ) == ESP_OK;
             }
         }
 
@@ -135,9 +210,114 @@ class I2C_PIF : public PIF
          * @param data
          * @param size
          */
-        void data( uint8_t* data, uint8_t size )
+        bool data( uint8_t* data, uint8_t size )
+        {
+            while ( m_chunk > 0 && size > m_chunk )
+            {
+                if ( write( 0x40, data, m_chunk ) != ESP_OK )
+                {
+                    return false;
+                }
+                data += m_chunk;
+                size -= m_chunk;
+            }
+            return write( 0x40, data, size ) == ESP_OK;
+        }
+
+        /**
+         * @brief Change the bus clock
+         *
+         * Only where the port driver was installed by an I2C_PIF or an I2C_Bus, and shared by
+         * every device on the port.
+         *
+         * @param hz bus clock in Hz
+         * @return true if the clock was changed
+         */
+        bool speed( uint32_t hz )
+        {
+            return I2C_Bus::speed( i2c_master_port, hz );
+        }
+
+        /**
+         * @brief Read the SSD1306 status byte
+         * @param status the status byte
+         * @return the driver result
+         */
+        esp_err_t read_status( uint8_t& status )
         {
-            write( 0x40, data, size );
+            i2c_cmd_handle_t cmdlink = i2c_cmd_link_create();
+            i2c_master_start( cmdlink );
+            i2c_master_write_byte( cmdlink, m_address_read, 1 );
+            i2c_master_read_byte( cmdlink, &status, I2C_MASTER_NACK );
+            i2c_master_stop( cmdlink );
+            esp_err_t ret = begin( cmdlink );
+            i2c_cmd_link_delete( cmdlink );
+            return ret;
+        }
+
+        /**
+         * @brief Find the highest reliable bus clock for this panel and wiring
+         *
+         * Steps up through the clock rates writing test patterns to GDDRAM and reading the status
+         * byte back, and keeps the fastest rate below the first that shows errors. The result is
+         * kept in NVS, which the application must have initialized, so later boots just apply it.
+         * The panel is written to, so calibrate before SSD1306::init().
+         *
+         * @param force probe even if NVS holds a result
+         * @param rounds pattern writes per clock rate
+         * @return the bus clock in Hz, 0 if the clock cannot be changed
+         */
+        uint32_t calibrate( bool force = false, uint8_t rounds = 16 )
+        {
+            static const uint32_t SPEEDS[] = { 100000, 400000, 600000, 800000, 1000000 };
+
+            char key[16];
+            snprintf( key, sizeof ( key ), "i2c%d_%02x", i2c_master_port, m_address_write >> 1 );
+
+            nvs_handle handle;
+            bool nvs = nvs_open( NVS_NAMESPACE, NVS_READWRITE, &handle ) == ESP_OK;
+            uint32_t hz { 0 };
+
+            if ( nvs && !force && nvs_get_u32( handle, key, &hz ) == ESP_OK && speed( hz ) )
+            {
+                ESP_LOGI( TAG, "calibrate - %s %uHz from NVS", key, hz );
+                nvs_close( handle );
+                return hz;
+            }
+
+            uint8_t expected;
+            if ( !speed( SPEEDS[0] ) || read_status( expected ) != ESP_OK )
+            {
+                ESP_LOGE( TAG, "calibrate - %s not responding", key );
+                if ( nvs )
+                {
+                    nvs_close( handle );
+                }
+                return 0;
+            }
+
+            hz = SPEEDS[0];
+            for ( uint8_t i = 1; i < sizeof ( SPEEDS ) / sizeof ( SPEEDS[0] ); i++ )
+            {
+                uint16_t errors = speed( SPEEDS[i] ) ? probe( rounds, expected ) : rounds;
+                ESP_LOGD( TAG, "calibrate - %s %uHz, %d errors", key, SPEEDS[i], errors );
+                if ( errors > 0 )
+                {
+                    break;
+                }
+                hz = SPEEDS[i];
+            }
+
+            speed( hz );
+            ESP_LOGI( TAG, "calibrate - %s %uHz", key, hz );
+
+            if ( nvs )
+            {
+                nvs_set_u32( handle, key, hz );
+                nvs_commit( handle );
+                nvs_close( handle );
+            }
+            return hz;
         }
 
         /**
@@ -159,7 +339,7 @@ class I2C_PIF : public PIF
                     i2c_master_start( cmd );
                     i2c_master_write_byte( cmd, ( address << 1 ) | I2C_MASTER_WRITE, 1 );
                     i2c_master_stop( cmd );
-                    esp_err_t ret = i2c_master_cmd_begin( i2c_master_port, cmd, 50 / portTICK_RATE_MS );
+                    esp_err_t ret = begin( cmd );
                     i2c_cmd_link_delete( cmd );
                     if ( ret == ESP_OK )
                     {
@@ -0,0 +1,72 @@
+/*
+ ESP32-SSD1306-Driver Library Numeric Field
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_NUMERIC_FIELD_H_
+#define SSD1306_NUMERIC_FIELD_H_
+
+#include <stdint.h>
+
+#include "Canvas.h"
+
+/**
+ * @brief Fixed width integer or fixed-point number display
+ *
+ * The field's glyphs - the digits, minus, blank and decimal point - are rasterized once into
+ * fixed width page format cells when the field is constructed. Values are formatted right
+ * aligned into the cells without stdio or the heap, and only the cells whose character changed
+ * since the last draw are blitted, opaque, onto the canvas; a ticking counter redraws a digit a
+ * tick rather than the whole string.
+ */
+class Numeric_Field
+{
+public:
+    static const constexpr uint8_t CELLS = 11; ///< Most digit cells, an int32_t with its sign
+
+    Numeric_Field(uint8_t x, uint8_t y, uint8_t font, uint8_t digits, uint8_t decimals = 0, bool zeros = false,
+                  color_t color = WHITE);
+    Numeric_Field(const Numeric_Field &) = delete;
+    Numeric_Field &operator=(const Numeric_Field &) = delete;
+
+    ~Numeric_Field();
+
+    uint8_t update(Canvas &canvas, int32_t value);
+    void redraw(Canvas &canvas);
+    uint16_t width();
+    uint8_t height();
+
+private:
+    uint8_t m_x;        ///< Field left
+    uint8_t m_y;        ///< Field top
+    uint8_t m_digits;   ///< Digit cells, the sign included
+    uint8_t m_decimals; ///< Digit cells after the point
+    bool m_zeros;       ///< Pad with leading zeros rather than blanks
+    uint8_t m_height;   ///< Font height
+    uint8_t m_pages;    ///< Pages of a cached glyph
+    uint8_t m_cell;     ///< Width of a digit cell, the gap included
+    uint8_t m_point;    ///< Width of the point cell, the gap included, 0 for none
+    uint8_t *m_glyphs;  ///< Cached glyphs, page format, a cell each then the point
+
+    char m_shown[CELLS];  ///< Characters drawn in each cell, 0 where unknown
+    int32_t m_value{0};   ///< Value last updated
+
+    void format(int32_t value, char *text);
+    void draw(Canvas &canvas, uint8_t cell, char c);
+    uint8_t *glyph(char c);
+};
+
+#endif /* SSD1306_NUMERIC_FIELD_H_ */
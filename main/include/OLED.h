@@ -28,8 +28,11 @@
 #include <vector>
 
 #include <Font_Manager.h>
+#include "Chart.h"
 #include "Display.h"
+#include "Numeric_Field.h"
 #include "SSD1306.h"
+#include "Text_Layout.h"
 
 /**
  * @brief 
@@ -41,7 +44,10 @@ class OLED : public Display
 
 private:
         Font_Manager *m_font_manager{nullptr}; ///< The current font
+        Font_Manager *m_vertical_font{nullptr}; ///< The current font, row scanned for vertical text
+        uint8_t m_style{STYLE_NORMAL};          ///< The current text style flags
         SSD1306 &m_ssd1306;                    ///< SSD1306 driving this Display
+        Text_Layout m_layout;                  ///< Memoized layouts of text drawn in boxes
 
 public:
         /**
@@ -63,19 +69,38 @@ public:
         virtual Display &draw_hline(uint8_t x, uint8_t y, uint8_t w, color_t color);
         virtual Display &draw_vline(uint8_t x, uint8_t y, uint8_t h, color_t color);
         virtual Display &draw_line(uint8_t x, uint8_t y, uint8_t xx, uint8_t yy, color_t color);
+        virtual Display &draw_polyline(const uint8_t *xs, const uint8_t *ys, uint8_t count, color_t color);
+        virtual Display &draw_sparkline(uint8_t x, const uint8_t *ys, uint8_t count, color_t color);
         virtual Display &draw_rectangle(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_t color);
         virtual Display &fill_rectangle(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_t color);
         virtual Display &draw_circle(uint8_t x0, uint8_t y0, uint8_t r, color_t color);
         virtual Display &fill_circle(uint8_t x0, uint8_t y0, uint8_t r, color_t color);
+        virtual Display &draw_image(int16_t x, int16_t y, const image_t &image, rop_t rop = ROP_OR);
         virtual Display &draw_char(uint8_t x, uint8_t y, unsigned char c, color_t foreground, color_t background,
                                    uint8_t *outwidth = nullptr);
         virtual Display &draw_string(uint8_t x, uint8_t y, std::string str, color_t foreground, color_t background,
                                      uint8_t *outwidth = nullptr);
+        Display &draw_string_vertical(uint8_t x, uint8_t y, std::string str, color_t foreground, color_t background,
+                                      uint8_t *outheight = nullptr);
+        Display &draw_string_scaled(uint8_t x, uint8_t y, std::string str, uint8_t scale, color_t foreground,
+                                    color_t background, uint8_t *outwidth = nullptr);
+        Display &draw_text(uint8_t x, uint8_t y, uint8_t w, uint8_t h, const std::string &str, color_t foreground,
+                           color_t background, align_t align = ALIGN_LEFT, uint8_t flags = LAYOUT_WRAP,
+                           uint8_t *outlines = nullptr);
+        Display &composite(Canvas &canvas, int16_t x, int16_t y, rop_t rop = ROP_COPY);
+        Display &viewport(Canvas &canvas, int16_t left, int16_t top);
+        Display &plot(Chart &chart, int16_t sample, color_t color = WHITE);
+        Display &draw_chart(Chart &chart, color_t color = WHITE);
+        Display &draw_number(Numeric_Field &field, int32_t value, uint8_t *outcells = nullptr);
+        Display &draw_field(Numeric_Field &field);
         virtual uint8_t measure_string(std::string str);
         virtual uint8_t font_height();
         virtual uint8_t font_c();
         const virtual char *font_name();
         virtual Display &select_font(uint8_t idx);
+        Display &fit_font(std::string str, uint8_t w, uint8_t h, Font_Manager::Charset charset = Font_Manager::ASCII,
+                          bool *outfit = nullptr);
+        Display &select_style(uint8_t style);
 };
 
 #endif /* SSD1306_OLED_H_ */
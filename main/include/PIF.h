@@ -47,24 +47,27 @@ class PIF
          * @brief Sends a SSD1306 command over the wire protocol to the SSD1306 from the ESP32
          * 
          * @param cmd the command
+         * @return true if sent
          */
-        virtual void command(const uint8_t cmd ) = 0;
+        virtual bool command(const uint8_t cmd ) = 0;
 
         /**
          * @brief Sends SSD1306 commands over the wire protocol to the SSD1306 from the ESP32
          * 
          * @param cmd the command
          * @param size size of command in bytes
+         * @return true if sent
          */
-        virtual void command(const uint8_t* cmd, uint8_t size ) = 0;
+        virtual bool command(const uint8_t* cmd, uint8_t size ) = 0;
 
         /**
          * @brief Sends SSD1306 data over the wire protocol to the SSD1306 from the ESP32
          * 
          * @param data the data
          * @param size size of data in bytes
+         * @return true if sent
          */
-        virtual void data( uint8_t* data, uint8_t size ) = 0;
+        virtual bool data( uint8_t* data, uint8_t size ) = 0;
 };
 
 #endif // SSD1306_PIF_H_
@@ -0,0 +1,90 @@
+/*
+ ESP32-SSD1306-Driver Library Panel Manager
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_PANEL_MANAGER_H_
+#define SSD1306_PANEL_MANAGER_H_
+
+#include <esp_log.h>
+#include <sdkconfig.h>
+#include <stdint.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+
+#include "SSD1306.h"
+
+#ifndef CONFIG_SSD1306_BUS_TASK_STACK
+#define CONFIG_SSD1306_BUS_TASK_STACK 4096
+#endif
+
+/**
+ * @brief Drives several panels across several buses
+ *
+ * Panels are grouped by the bus they are wired to; panels on one bus are refreshed one after
+ * the other, while each bus has its own task so that the buses transfer concurrently. A frame
+ * across all panels then takes about as long as the slowest bus rather than the sum of them.
+ *
+ * Bus numbers are the caller's own, e.g. 0 and 1 for the I2C ports and 2 for SPI. A panel's
+ * buffer must not be drawn on while its bus is refreshing; wait() for the bus first.
+ */
+class Panel_Manager
+{
+    static const constexpr char *TAG = "Panel_Manager";
+
+public:
+    static const constexpr uint8_t MAX_BUSES = 4;  ///< Buses managed
+    static const constexpr uint8_t MAX_PANELS = 4; ///< Panels per bus
+
+    Panel_Manager();
+
+    virtual ~Panel_Manager();
+
+    bool add(SSD1306 &panel, uint8_t bus);
+    bool bus(uint8_t bus, BaseType_t core, UBaseType_t priority = 5);
+    bool start();
+    void refresh(bool force = false);
+    bool wait(TickType_t timeout = portMAX_DELAY);
+    bool wait(uint8_t bus, TickType_t timeout);
+    bool refresh_all(bool force = false, TickType_t timeout = portMAX_DELAY);
+    uint32_t frame_ticks(uint8_t bus);
+
+private:
+    struct bus_t ///< A bus and the panels on it
+    {
+        SSD1306 *panels[MAX_PANELS];      ///< Panels on the bus, refreshed in order
+        uint8_t count{0};                 ///< Panels on the bus
+        BaseType_t core{tskNO_AFFINITY};  ///< Core the bus task is pinned to
+        UBaseType_t priority{5};          ///< Bus task priority
+        TaskHandle_t task{nullptr};       ///< Bus task
+        Panel_Manager *manager{nullptr};  ///< Owning manager
+        uint8_t index{0};                 ///< Bus number, also its event bit
+        bool force{false};                ///< Force a full refresh this frame
+        bool stop{false};                 ///< Task to exit
+        TickType_t ticks{0};              ///< Duration of the last refresh
+        UBaseType_t headroom{UINT32_MAX}; ///< Least stack left, logged with the statistics
+    } m_buses[MAX_BUSES];
+
+    EventGroupHandle_t m_done; ///< Bus refresh complete bits
+    EventBits_t m_running{0};  ///< Bits of buses whose task is running
+    EventBits_t m_panelled{0}; ///< Bits of buses with panels
+
+    static void run(void *arg);
+};
+
+#endif /* SSD1306_PANEL_MANAGER_H_ */
@@ -24,6 +24,7 @@
 #include <driver/spi_master.h>
 
 #include "PIF.h"
+#include "Stats.h"
 
 /**
  * @brief SPI implementation of PIF 
@@ -46,7 +47,7 @@ private:
          * @param ctrl
          * @param data
          */
-    void write(const uint8_t ctrl, const uint8_t data)
+    esp_err_t write(const uint8_t ctrl, const uint8_t data)
     {
         i2c_cmd_handle_t cmdlink = i2c_cmd_link_create();
         i2c_master_start(cmdlink);
@@ -54,8 +55,12 @@ private:
         i2c_master_write_byte(cmdlink, ctrl, 1);
         i2c_master_write_byte(cmdlink, data, 1);
         i2c_master_stop(cmdlink);
-        i2c_master_cmd_begin(i2c_master_port, cmdlink, 50 / portTICK_RATE_MS);
+        STATS_ADD(bytes, 3);
+        STATS_ADD(transactions, 1);
+        STATS_TIME(bus);
+        esp_err_t ret = i2c_master_cmd_begin(i2c_master_port, cmdlink, 50 / portTICK_RATE_MS);
         i2c_cmd_link_delete(cmdlink);
+        return ret;
     }
 
     /**
@@ -64,7 +69,7 @@ private:
          * @param data
          * @param size
          */
-    void write(const uint8_t ctrl, const uint8_t *data, uint8_t size)
+    esp_err_t write(const uint8_t ctrl, const uint8_t *data, uint8_t size)
     {
         i2c_cmd_handle_t cmdlink = i2c_cmd_link_create();
         i2c_master_start(cmdlink);
@@ -72,8 +77,12 @@ private:
         i2c_master_write_byte(cmdlink, ctrl, 1);
         i2c_master_write(cmdlink, data, size, 1);
         i2c_master_stop(cmdlink);
-        i2c_master_cmd_begin(i2c_master_port, cmdlink, 50 / portTICK_RATE_MS);
+        STATS_ADD(bytes, 2 + size);
+        STATS_ADD(transactions, 1);
+        STATS_TIME(bus);
+        esp_err_t ret = i2c_master_cmd_begin(i2c_master_port, cmdlink, 50 / portTICK_RATE_MS);
         i2c_cmd_link_delete(cmdlink);
+        return ret;
     }
 
 public:
@@ -109,20 +118,20 @@ public:
          *
          * @param cmd
          */
-    void command(const uint8_t cmd)
+    bool command(const uint8_t cmd)
     {
-        write(0x00, cmd);
+        return write(0x00, cmd) == ESP_OK;
     }
 
-    void command(const uint8_t *cmd, uint8_t size)
+    bool command(const uint8_t *cmd, uint8_t size)
     {
         if (size > 0)
         {
-            write(0x00, cmd, size);
+            return write(0x00, cmd, size) == ESP_OK;
         }
         else
         {
-            write(0x00, cmd, sizeof(cmd));
+            return write(0x00, cmd, sizeof(cmd)) == ESP_OK;
         }
     }
 
@@ -131,9 +140,9 @@ public:
          * @param data
          * @param size
          */
-    void data(uint8_t *data, uint8_t size)
+    bool data(uint8_t *data, uint8_t size)
     {
-        write(0x40, data, size);
+        return write(0x40, data, size) == ESP_OK;
     }
 
     /**
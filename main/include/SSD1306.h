@@ -22,12 +22,14 @@
 #define CMD_CHARGEPUMP 0x8d
 #define CMD_COLUMNADDR 0x21
 #define CMD_COMSCANDEC 0xc8
+#define CMD_COMSCANINC 0xc0
 #define CMD_DEACTIVATE_SCROLL 0x2e
 #define CMD_DISPLAYALLON_RESUME 0xa4
 #define CMD_DISPLAYOFF 0xae
 #define CMD_DISPLAYON 0xaf
 #define CMD_INVERTDISPLAY 0xa7
 #define CMD_MEMORYMODE 0x20
+#define CMD_NOP 0xe3
 #define CMD_NORMALDISPLAY 0xa6
 #define CMD_PAGEADDR 0x22
 #define CMD_SETCOMPINS 0xda
@@ -40,6 +42,10 @@
 #define CMD_SETSEGREMAP_0 0xa0
 #define CMD_SETSEGREMAP_127 0xa1
 #define CMD_SETVCOMDETECT 0xdb
+#define CMD_SETLOWCOLUMN 0x00
+#define CMD_SETHIGHCOLUMN 0x10
+#define CMD_SETPAGESTART 0xb0
+#define CMD_SH1106_DCDC 0xad
 
 #include <esp_log.h>
 #include <stdio.h>
@@ -47,152 +53,229 @@
 #include <algorithm>
 #include <string.h>
 #include <stdint.h>
-#include <algorithm>
 
+#include "Canvas.h"
 #include "PIF.h"
 
 /**
- * @brief Color options supported by the SSD1306
+ * @brief Panel type
  * 
+ * Panel type and dimensions, with the enumerator indicating the number of memory pages
  */
-enum color_t
+enum panel_type_t
 {
-    TRANSPARENT = -1, ///< Transparent (not drawing)
-    BLACK = 0,        ///< Black (pixel off)
-    WHITE = 1,        ///< White (or blue, yellow, pixel on)
-    INVERT = 2,       ///< Invert pixel (XOR)
+    SSD1306_128x64 = 8, ///< 128x32 panel, 8 pages of memory
+    SSD1306_128x32 = 4  ///< 128x64 panel, 4 pages of memory
 };
 
 /**
- * @brief Panel type
+ * @brief Panel controller variant
  * 
- * Panel type and dimensions, with the enumerator indicating the number of memory pages
  */
-enum panel_type_t
+enum controller_t
 {
-    SSD1306_128x64 = 8, ///< 128x32 panel, 8 pages of memory
-    SSD1306_128x32 = 4  ///< 128x64 panel, 4 pages of memory
+    CONTROLLER_SSD1306, ///< SSD1306, 128 column GDDRAM, up to 64 rows
+    CONTROLLER_SH1106,  ///< SH1106, page addressing only, 132 column GDDRAM, up to 64 rows
+};
+
+/**
+ * @brief Panel orientation
+ * 
+ * Mirroring is set by the controller's segment remap and COM scan direction; transposing is done
+ * by the driver, drawing into a buffer of the transposed size that is turned into panel pages as
+ * it is refreshed. The quarter turns are a transpose and a mirror.
+ */
+enum orientation_t
+{
+    ORIENTATION_0 = 0,         ///< As mounted
+    ORIENTATION_MIRROR_H = 1,  ///< Mirrored left to right
+    ORIENTATION_MIRROR_V = 2,  ///< Mirrored top to bottom
+    ORIENTATION_180 = 3,       ///< Upside down, mirrored both ways
+    ORIENTATION_TRANSPOSE = 4, ///< Rows and columns swapped, width and height with them
+    ORIENTATION_90 = 5,        ///< Turned a quarter clockwise, portrait on a landscape panel
+    ORIENTATION_270 = 6,       ///< Turned a quarter anticlockwise
+};
+
+/**
+ * @brief Panel geometry and the init settings that follow from it
+ * 
+ */
+struct panel_geometry_t
+{
+    uint8_t width;           ///< Visible columns
+    uint8_t height;          ///< Visible rows
+    uint8_t columnoffset;    ///< First GDDRAM column shown
+    uint8_t compins;         ///< COM pins hardware configuration
+    uint8_t contrast;        ///< Initial contrast
+    uint8_t vcomdetect;      ///< VCOMH deselect level
+    controller_t controller; ///< Controller variant
+};
+
+/**
+ * @brief Geometry of a panel of the given size
+ * 
+ * Narrow SSD1306 panels (72x40, 64x48, 64x32) show the centre columns of the GDDRAM; the SH1106
+ * centres 128 visible columns in its 132 column GDDRAM.
+ * 
+ * @param w panel width
+ * @param h panel height
+ * @param c controller variant
+ * @return the panel geometry
+ */
+constexpr panel_geometry_t panel_geometry(uint8_t w, uint8_t h, controller_t c = CONTROLLER_SSD1306)
+{
+    return panel_geometry_t{w, h,
+                            static_cast<uint8_t>(c == CONTROLLER_SH1106 ? (132 - w) / 2 : (w == 96 ? 0 : (128 - w) / 2)),
+                            static_cast<uint8_t>(h > 32 ? 0x12 : 0x02),
+                            static_cast<uint8_t>(h == 32 ? 0x2f : (h == 16 ? 0xaf : 0xcf)),
+                            static_cast<uint8_t>(h > 32 ? 0x30 : 0x40),
+                            c};
+}
+
+/**
+ * @brief Transport error counters
+ * 
+ */
+struct transport_errors_t
+{
+    uint32_t failures;  ///< Failed transfers, including those retried
+    uint32_t retries;   ///< Transfers retried
+    uint32_t refreshes; ///< Refreshes abandoned, their remainder left dirty
+    uint32_t reinits;   ///< Panel re-initialization attempts after repeated failed refreshes
 };
 
 /**
  * @brief SSD1306 chip driver, commands and controls
  * 
+ * The driver is a canvas over the panel buffer, adding the panel commands and refresh.
  */
-class SSD1306
+class SSD1306 : public Canvas
 {
     static const constexpr char *TAG = "SSD1306";
 
 public:
     SSD1306(PIF *pif, panel_type_t type);
+    SSD1306(PIF *pif, const panel_geometry_t &geometry);
+    SSD1306(PIF *pif, uint8_t *buffer, const panel_geometry_t &geometry, uint8_t *shadow = nullptr);
 
     virtual ~SSD1306()
     {
+        if (m_shadow_owner)
+            delete[] m_shadow;
+        delete[] m_transposed;
     }
 
     bool init();
     void powerdown();
-    uint8_t width();
-    uint8_t height();
     void clear(bool limit = false);
-    void refresh(bool force);
-    bool segment(uint8_t page, uint8_t column, uint8_t bits, color_t color, uint8_t count = 1);
-    bool pixel(uint8_t x, uint8_t y, color_t color);
-    bool box(uint8_t x, uint8_t y, color_t color, uint8_t w, uint8_t h);
-    bool horizontal(uint8_t x, uint8_t y, color_t color, uint8_t w, uint8_t h = 1);
-    bool vertical(uint8_t x, uint8_t y, color_t color, uint8_t h, uint8_t w = 1);
-    void line(uint8_t x, uint8_t y, color_t color, uint8_t xx, uint8_t yy);
+    bool refresh(bool force);
     void invert_display(bool invert);
     void update_buffer(uint8_t *data, uint16_t length);
+    const transport_errors_t &errors();
+    void transaction_overhead(uint8_t bytes);
+    uint8_t transaction_overhead();
+    bool double_buffer(bool enable);
+    bool orientation(orientation_t orientation);
+    orientation_t orientation();
 
 private:
-    static const constexpr uint8_t COLUMNS = 128; ///< SSD1306 is a 128 column driver chip
+    static const constexpr uint8_t COLUMNS = 128;    ///< SSD1306 is a 128 column driver chip
+    static const constexpr uint8_t RETRIES = 2;      ///< Retries of a failed transfer
+    static const constexpr uint8_t REINIT_AFTER = 3; ///< Failed refreshes in a row before re-initializing
+    static const constexpr uint8_t OVERHEAD = 4;     ///< Transaction overhead in bus bytes, until measured
+    static const constexpr uint8_t MAX_TRANSFER = 255; ///< Largest PIF transfer
+    static const constexpr uint8_t MAX_PAGES = 8;      ///< GDDRAM pages of the largest panel
+    static const constexpr uint8_t SSD1306_PAGES = 8;  ///< GDDRAM pages of the SSD1306
+    static_assert(dirtywindow::SPANS >= MAX_PAGES, "Every page needs its dirty span");
 
-    const uint8_t BITS[8] = {0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF}; ///< Segment bit mask
+    enum addressing_t ///< Panel GDDRAM addressing mode
+    {
+        ADDRESSING_UNKNOWN,    ///< Not known after a failed command, which may also be left part sent
+        ADDRESSING_HORIZONTAL, ///< Window addressing, data runs on to the next page
+        ADDRESSING_PAGE,       ///< Page addressing, each page positioned on its own
+    };
 
-    bool m_init{false};
-    PIF *m_pif;                   ///< Wire protocol adapter
-    panel_type_t m_type;          ///< panel type
-    uint8_t (*m_buffer)[COLUMNS]; ///< Display buffer - Page by Column
-    uint16_t m_buffer_bytes;       ///< buffer size in bytes
-    uint8_t m_width{COLUMNS};     ///< panel width (128)
-    uint8_t m_height;             ///< panel height (32 or 64)
-    uint16_t m_pixels;            ///< panel pixel count
-
-    struct dirtywindow ///< "Dirty" window
+    struct band_t ///< A window of the refresh plan
     {
-        bool isdirty{false};
-        uint8_t toppage{255};
-        uint8_t leftcol{255};
-        uint8_t rightcol{0};
-        uint8_t bottompage{0};
-
-        void clear() ///< Clear the dirty window
-        {
-            toppage = 255;
-            leftcol = 255;
-            rightcol = 0;
-            bottompage = 0;
-            isdirty = false;
-        }
-
-        void touch(uint8_t page, uint8_t colstart, uint8_t colend = 0) ///< Touch part of the window
-        {
-            toppage = std::min(toppage, page);
-            bottompage = std::max(bottompage, page);
-            leftcol = std::min(leftcol, colstart);
-            rightcol = std::max(rightcol, colend);
-            isdirty = true;
-        }
-
-        void touch() ///< Touch the entire window
-        {
-            toppage = 0;
-            bottompage = 255;
-            leftcol = 0;
-            rightcol = COLUMNS - 1;
-            isdirty = true;
-        }
-    } m_dirtywindow;
+        uint8_t toppage;
+        uint8_t bottompage;
+        uint8_t leftcol;
+        uint8_t rightcol;
+    };
+
+    bool m_init{false};
+    PIF *m_pif;                  ///< Wire protocol adapter
+    panel_geometry_t m_geometry; ///< Panel geometry
 
     dirtywindow m_previous_dirtywindow;
 
-    uint8_t initcmds32[25] = ///< initiate 32 line display
-        {CMD_DISPLAYOFF,
-         CMD_SETDISPLAYCLOCKDIV, 0x80, ///< Suggested value 0x80
-         CMD_SETMULTIPLEX, 0x1f,       ///< 1/32
-         CMD_SETDISPLAYOFFSET, 0x00,   ///< 0 no offset
-         CMD_SETDISPLAYSTARTLINE + 0,  ///< line #0
-         CMD_MEMORYMODE, 0x00,         ///< 0x0 act like ks0108
-         CMD_SETSEGREMAP_127,
-         CMD_COMSCANDEC,
-         CMD_SETCOMPINS, 0x02,
-         CMD_SETCONTRAST, 0x2f,
-         CMD_SETPRECHARGE, 0xf1,
-         CMD_SETVCOMDETECT, 0x40,
-         CMD_DEACTIVATE_SCROLL,
-         CMD_CHARGEPUMP, 0x14, ///< Charge pump on
-         CMD_DISPLAYALLON_RESUME,
-         CMD_NORMALDISPLAY};
-
-    uint8_t initcmds64[25] = ///< Initiate 64 line display
-        {CMD_DISPLAYOFF,
-         CMD_SETDISPLAYCLOCKDIV, 0x80, ///< Suggested value 0x80
-         CMD_SETMULTIPLEX, 0x3f,       ///< 1/64
-         CMD_SETDISPLAYOFFSET, 0x00,   ///< 0 no offset
-         CMD_SETDISPLAYSTARTLINE + 0,  ///< line #0
-         CMD_MEMORYMODE, 0x00,         ///< 0x0 act like ks0108
-         CMD_SETSEGREMAP_127,
-         CMD_COMSCANDEC,
-         CMD_SETCOMPINS, 0x12,
-         CMD_SETCONTRAST, 0xcf,
-         CMD_SETPRECHARGE, 0xf1,
-         CMD_SETVCOMDETECT, 0x30,
-         CMD_DEACTIVATE_SCROLL,
-         CMD_CHARGEPUMP, 0x14, ///< Charge pump on
-         CMD_DISPLAYALLON_RESUME,
-         CMD_NORMALDISPLAY};
+    uint8_t *m_shadow{nullptr};  ///< The frame last sent, if kept
+    bool m_shadow_owner{false};  ///< Shadow allocated by this driver
+    uint16_t m_unsure{0xFFFF};   ///< Pages whose panel contents are not known, bit per page
+
+    bool m_flip{false};   ///< Double buffered, refreshes write the hidden half and flip to it
+    uint8_t m_rampage{0}; ///< GDDRAM page of the buffer's first page, the hidden half when flipping
+    dirtywindow m_stale;  ///< Changes the hidden half lacks, those shown by the last flip
+    bool m_flip_failed{false}; ///< The last flip failed, which half is shown is not known
+
+    orientation_t m_orientation{ORIENTATION_0}; ///< Segment remap and COM scan
+    uint8_t *m_transposed{nullptr};             ///< Panel pages transposed from the buffer, when transposing
+
+    transport_errors_t m_errors{0, 0, 0, 0}; ///< Transport error counters
+    uint8_t m_failed_refreshes{0};           ///< Failed refreshes in a row
+
+    addressing_t m_addressing{ADDRESSING_UNKNOWN}; ///< Panel addressing mode
+    uint8_t m_overhead{OVERHEAD};                  ///< Transaction overhead in bus bytes
+    bool m_overhead_fixed{false};                  ///< Overhead set rather than measured
+    uint32_t m_short_us{0}, m_short_bytes{0};      ///< Average short transfer, x16
+    uint32_t m_long_us{0}, m_long_bytes{0};        ///< Average long transfer, x16
 
     uint8_t pwrdwncmds[3]{CMD_DISPLAYOFF, CMD_CHARGEPUMP, 0x10}; ///< Charge pump off
+
+    bool configure();
+    bool recover();
+    bool command(uint8_t *cmds, uint8_t size);
+    uint32_t cost(const band_t &band, bool paged);
+    uint8_t plan(const dirtywindow &window, band_t *bands, bool &paged);
+    bool transfer(uint8_t page, uint8_t pages, const band_t &band, bool paged, bool &positioned);
+    bool send(bool data, const uint8_t *bytes, uint8_t size);
+    uint8_t *sent(uint8_t page);
+    uint8_t *frame(uint8_t page);
+    uint8_t columnoffset();
+    dirtywindow tiles(const dirtywindow &window);
+    void transpose(uint8_t page, uint16_t colstart, uint16_t colend);
+};
+
+/**
+ * @brief SSD1306 driver for a panel geometry fixed at compile time
+ * 
+ * The display buffer is held inline, sized from the geometry, so no heap is used and the
+ * geometry is checked against the controller limits when compiled.
+ * 
+ * @tparam W panel width
+ * @tparam H panel height
+ * @tparam C controller variant
+ */
+template <uint8_t W, uint8_t H, controller_t C = CONTROLLER_SSD1306>
+class SSD1306_Panel : public SSD1306
+{
+    static_assert(W > 0 && H > 0 && H % 8 == 0, "Panel height must be a whole number of pages");
+    static_assert(C != CONTROLLER_SSD1306 || (W <= 128 && H <= 64), "SSD1306 drives up to 128x64");
+    static_assert(C != CONTROLLER_SH1106 || (W <= 132 && H <= 64), "SH1106 drives up to 132x64");
+
+public:
+    static const constexpr uint8_t WIDTH = W;          ///< Panel width
+    static const constexpr uint8_t HEIGHT = H;         ///< Panel height
+    static const constexpr uint8_t PAGES = H / 8;      ///< GDDRAM pages shown
+    static const constexpr uint16_t BYTES = PAGES * W; ///< Display buffer size
+
+    SSD1306_Panel(PIF *pif) : SSD1306(pif, m_frame[0], panel_geometry(W, H, C), m_sent[0])
+    {
+    }
+
+private:
+    uint8_t m_frame[PAGES][W]{}; ///< Display buffer - Page by Column
+    uint8_t m_sent[PAGES][W]{};  ///< Frame last sent to the panel
 };
 
 #endif /* SSD1306_SSD1306_H */
@@ -0,0 +1,153 @@
+/*
+ ESP32-SSD1306-Driver Library Frame Statistics
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_STATS_H_
+#define SSD1306_STATS_H_
+
+#include <sdkconfig.h>
+#include <stdint.h>
+
+/*
+ * Instrumentation is compiled in with CONFIG_SSD1306_STATS, see Kconfig.projbuild; otherwise
+ * the STATS_ macros compile to nothing.
+ */
+#ifdef CONFIG_SSD1306_STATS
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <soc/cpu.h>
+#define STATS_UNIT "cycles"
+#else
+#include <chrono>
+#include <mutex>
+#define STATS_UNIT "ns"
+#endif
+
+/**
+ * @brief Counters and timers accumulated since the last reset
+ *
+ * Times are in CPU cycles on target and nanoseconds on the host. Draw and buffer times are
+ * exclusive of each other: buffer operations made by a draw call count as draw time. The
+ * refresh time includes its bus time.
+ *
+ * The statistics are shared by every task drawing and refreshing, Panel_Manager's bus tasks
+ * included, and updated under a lock; read them with stats_snapshot().
+ */
+struct frame_stats_t
+{
+    uint64_t draw;         ///< Rasterization, in Display draw calls
+    uint64_t buffer;       ///< Frame buffer operations: clear, blit, scroll, text
+    uint64_t refresh;      ///< Refresh, including the bus transfer
+    uint64_t bus;          ///< Bus transfer
+    uint32_t bytes;        ///< Bytes on the bus, including address and control bytes
+    uint32_t transactions; ///< Bus transactions
+    uint32_t dirty;        ///< Pixels refreshed
+    uint32_t glyphs;       ///< Glyphs drawn
+    uint32_t frames;       ///< Refreshes that sent data
+};
+
+extern frame_stats_t ssd1306_stats;
+
+#ifdef ESP_PLATFORM
+extern portMUX_TYPE ssd1306_stats_lock;
+#define STATS_LOCK() portENTER_CRITICAL(&ssd1306_stats_lock)
+#define STATS_UNLOCK() portEXIT_CRITICAL(&ssd1306_stats_lock)
+#else
+extern std::mutex ssd1306_stats_lock;
+#define STATS_LOCK() ssd1306_stats_lock.lock()
+#define STATS_UNLOCK() ssd1306_stats_lock.unlock()
+#endif
+
+void stats_reset();
+void stats_frame();
+frame_stats_t stats_snapshot();
+
+/**
+ * @brief Add to a counter or timer
+ *
+ * @param counter the counter or timer
+ * @param n the amount
+ */
+template <typename T>
+inline void stats_add(T &counter, uint64_t n)
+{
+    STATS_LOCK();
+    counter += n;
+    STATS_UNLOCK();
+}
+
+/**
+ * @brief Times a scope into a stats timer
+ *
+ * Nested scopes sharing a depth counter only time the outermost. Depth counters are per task,
+ * so one task's draw does not hide another's.
+ */
+class stats_scope
+{
+public:
+    stats_scope(uint64_t &timer, uint8_t *depth = nullptr) : m_timer(timer), m_depth(depth)
+    {
+        if (m_depth)
+            m_nested = (*m_depth)++ > 0;
+        if (!m_nested)
+            m_start = now();
+    }
+
+    ~stats_scope()
+    {
+        if (!m_nested)
+            stats_add(m_timer, static_cast<uint32_t>(now() - m_start));
+        if (m_depth)
+            (*m_depth)--;
+    }
+
+    static uint32_t now()
+    {
+#ifdef ESP_PLATFORM
+        return esp_cpu_get_ccount();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+private:
+    uint64_t &m_timer;
+    uint8_t *m_depth;
+    bool m_nested{false};
+    uint32_t m_start{0};
+};
+
+extern thread_local uint8_t ssd1306_stats_raster_depth; ///< Draw and buffer scope nesting, per task
+
+#define STATS_ADD(counter, n) stats_add(ssd1306_stats.counter, (n))
+#define STATS_TIME(timer) stats_scope stats_scope_##timer(ssd1306_stats.timer)
+#define STATS_RASTER(timer) stats_scope stats_scope_##timer(ssd1306_stats.timer, &ssd1306_stats_raster_depth)
+#define STATS_FRAME() stats_frame()
+
+#else
+
+#define STATS_ADD(counter, n)
+#define STATS_TIME(timer)
+#define STATS_RASTER(timer)
+#define STATS_FRAME()
+
+#endif /* CONFIG_SSD1306_STATS */
+
+#endif /* SSD1306_STATS_H_ */
@@ -0,0 +1,106 @@
+/*
+ ESP32-SSD1306-Driver Library Text Layout
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_TEXT_LAYOUT_H_
+#define SSD1306_TEXT_LAYOUT_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+#include <Font_Manager.h>
+
+/**
+ * @brief Text alignment within a box
+ *
+ */
+enum align_t
+{
+    ALIGN_LEFT,   ///< Lines start at the box left
+    ALIGN_CENTER, ///< Lines centered in the box
+    ALIGN_RIGHT,  ///< Lines end at the box right
+};
+
+/**
+ * @brief Text layout flags, combined with |
+ *
+ */
+enum layout_flags_t
+{
+    LAYOUT_CLIP = 0,     ///< One line per paragraph, cut at the box right
+    LAYOUT_WRAP = 1,     ///< Lines broken between words, or within words too long for the box
+    LAYOUT_ELLIPSIS = 2, ///< Text cut short ends with "..."
+};
+
+/**
+ * @brief Breaks text into the lines that fit a box
+ *
+ * Paragraphs are split on newlines, and with LAYOUT_WRAP broken between words into lines no
+ * wider than the box; the lines that fit the box height are kept. A line's width includes the
+ * space after its last character, so aligned lines stay within the box.
+ *
+ * Layouts of texts of up to TEXT characters are memoized, keyed by font, text and box size, so
+ * text that does not change is measured once rather than every frame. The memo holds the last
+ * few layouts in fixed entries, with no heap, and a hit is confirmed by comparing the text.
+ * Longer texts are laid out every time.
+ */
+class Text_Layout
+{
+public:
+    static const constexpr uint8_t LINES = 16;  ///< Most lines in a layout
+    static const constexpr uint8_t ENTRIES = 4; ///< Layouts memoized
+    static const constexpr uint8_t TEXT = 80;   ///< Longest text memoized
+
+    struct line_t ///< A laid out line
+    {
+        uint16_t start;  ///< Index of the first character in the text
+        uint16_t length; ///< Number of characters
+        uint16_t width;  ///< Width in pixels, the ellipsis included
+        bool ellipsis;   ///< Followed by "..."
+    };
+
+    struct layout_t ///< A laid out text
+    {
+        const char *font{nullptr}; ///< Font name, the font key
+        char text[TEXT];           ///< The text, when no longer than TEXT
+        uint16_t size{0};          ///< Text length
+        uint16_t width{0};         ///< Box width
+        uint16_t height{0};        ///< Box height
+        uint8_t flags{0};          ///< Layout flags
+        uint8_t pitch{0};          ///< Distance between line tops
+        uint8_t count{0};          ///< Number of lines
+        line_t lines[LINES];       ///< The lines
+    };
+
+    const layout_t &layout(Font_Manager &font, const std::string &text, uint16_t width, uint16_t height,
+                           uint8_t flags);
+    uint16_t left(const line_t &line, uint16_t width, align_t align);
+
+    uint32_t hits{0};   ///< Layouts found in the memo
+    uint32_t misses{0}; ///< Layouts computed
+
+private:
+    layout_t m_entries[ENTRIES]; ///< The memo
+    uint8_t m_next{0};           ///< Entry to replace next, round robin
+
+    void compute(Font_Manager &font, const std::string &text, layout_t &layout);
+    void ellipsize(Font_Manager &font, const std::string &text, uint16_t width, line_t &line);
+};
+
+#endif /* SSD1306_TEXT_LAYOUT_H_ */
@@ -0,0 +1,213 @@
+/*
+ ESP32-SSD1306-Driver Library Trace Protocol Interface
+
+ v0.1.0
+
+ Copyright 2019 technosf [https://github.com/technosf]
+
+ Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ https://www.gnu.org/licenses/lgpl-3.0.en.html
+ Unless required by applicable law or agreed to in writing,
+ software distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef SSD1306_TRACE_PIF_H_
+#define SSD1306_TRACE_PIF_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
+
+#include "PIF.h"
+
+/**
+ * @brief PIF decorator recording the traffic to another PIF
+ *
+ * Every command and data transfer is passed on to the wrapped PIF and recorded, with its time
+ * and whether it failed, into a binary trace written to a stream - a file on SPIFFS or an SD
+ * card, or memory with fmemopen(). The host tool host/replay plays a trace into the emulated
+ * panel to reconstruct the frames, or re-drives the frames through the driver to compare its
+ * refresh with the recorded traffic.
+ *
+ * The trace is the header "SSDT" and the version, then records of:
+ *  - a type byte: TRACE_COMMAND, TRACE_DATA or TRACE_FRAME, with TRACE_FAILED set if the
+ *    transfer failed
+ *  - the microseconds since the previous record, as an unsigned LEB128 varint
+ *  - for commands and data, the size byte and the bytes sent
+ *
+ * Frame records are written by frame(), called after each refresh; without them the replay
+ * splits frames on gaps in the traffic.
+ */
+class Trace_PIF : public PIF
+{
+    public:
+
+        static const constexpr uint8_t VERSION = 1;
+
+        static const constexpr uint8_t TRACE_COMMAND = 0;   ///< Command transfer
+        static const constexpr uint8_t TRACE_DATA = 1;      ///< Data transfer
+        static const constexpr uint8_t TRACE_FRAME = 2;     ///< End of a frame
+        static const constexpr uint8_t TRACE_FAILED = 0x80; ///< Transfer failed
+
+        /**
+         * @brief Record the traffic to a PIF
+         * @param pif the PIF to pass the traffic on to
+         * @param trace stream to write the trace to, open for binary writing
+         */
+        Trace_PIF( PIF* pif, FILE* trace ) :
+                m_pif { pif }, m_trace { trace }
+        {
+            m_last = now();
+            static const uint8_t header[] { 'S', 'S', 'D', 'T', VERSION };
+            put( header, sizeof ( header ) );
+        }
+
+        virtual ~Trace_PIF()
+        {
+            if ( m_trace != nullptr )
+            {
+                fflush( m_trace );
+            }
+        }
+
+        virtual void info()
+        {
+            m_pif->info();
+            printf( "Trace: %u records%s\n", m_records, m_trace == nullptr ? ", stopped on a write error" : "" );
+        }
+
+        bool command(const uint8_t cmd )
+        {
+            return command( &cmd, 1 );
+        }
+
+        bool command(const uint8_t* cmd, uint8_t size )
+        {
+            bool sent = m_pif->command( cmd, size );
+            record( TRACE_COMMAND, sent, cmd, size );
+            return sent;
+        }
+
+        bool data( uint8_t* data, uint8_t size )
+        {
+            bool sent = m_pif->data( data, size );
+            record( TRACE_DATA, sent, data, size );
+            return sent;
+        }
+
+        /**
+         * @brief Mark the end of a frame, after a refresh
+         */
+        void frame()
+        {
+            record( TRACE_FRAME, true, nullptr, 0 );
+        }
+
+        /**
+         * @brief Flush the trace to its stream
+         */
+        void flush()
+        {
+            if ( m_trace != nullptr )
+            {
+                fflush( m_trace );
+            }
+        }
+
+        /**
+         * @brief Records written
+         */
+        uint32_t records()
+        {
+            return m_records;
+        }
+
+        /**
+         * @brief Whether the trace is still being written, false after a write error
+         */
+        bool recording()
+        {
+            return m_trace != nullptr;
+        }
+
+    private:
+
+        PIF* m_pif;
+        FILE* m_trace;
+        int64_t m_last;             ///< Time of the last record, microseconds
+        uint32_t m_records { 0 };
+
+        static int64_t now()
+        {
+#ifdef ESP_PLATFORM
+            return esp_timer_get_time();
+#else
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+        }
+
+        /**
+         * @brief Write a record
+         * @param type the record type
+         * @param sent whether the transfer succeeded
+         * @param bytes bytes transferred
+         * @param size number of bytes, none for a frame record
+         */
+        void record( uint8_t type, bool sent, const uint8_t* bytes, uint8_t size )
+        {
+            if ( m_trace == nullptr )
+            {
+                return;
+            }
+
+            int64_t time = now();
+            uint32_t delta = time - m_last;
+            m_last = time;
+
+            uint8_t head[7];    // Type, varint of up to 5 bytes, size
+            uint8_t n { 0 };
+            head[n++] = type | ( sent ? 0 : TRACE_FAILED );
+            do
+            {
+                head[n++] = ( delta & 0x7f ) | ( delta > 0x7f ? 0x80 : 0 );
+                delta >>= 7;
+            }
+            while ( delta );
+
+            if ( type != TRACE_FRAME )
+            {
+                head[n++] = size;
+            }
+
+            if ( put( head, n ) && put( bytes, size ) )
+            {
+                m_records++;
+            }
+        }
+
+        /**
+         * @brief Write to the trace, stopping the trace on an error
+         */
+        bool put( const uint8_t* bytes, uint8_t size )
+        {
+            if ( size > 0 && ( m_trace == nullptr || fwrite( bytes, 1, size, m_trace ) != size ) )
+            {
+                m_trace = nullptr;
+                return false;
+            }
+            return true;
+        }
+};
+
+#endif  // SSD1306_TRACE_PIF_H_
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+#
+# ESP32-SSD1306-Driver Library Image Converter
+#
+# Copyright 2019 technosf [https://github.com/technosf]
+#
+# Licensed under the GNU LESSER GENERAL PUBLIC LICENSE, Version 3.0 or greater (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# https://www.gnu.org/licenses/lgpl-3.0.en.html
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and limitations under the License.
+#
+"""Convert PBM or PNG images into page format (TBLR) image_t C source for SSD1306::blit().
+
+PBM (P1/P4) is read natively, other formats need Pillow. Set pixels are black in PBM; for
+other formats pixels brighter than the threshold are set. With --mask the alpha channel
+(or, for PBM, a second PBM file) becomes the mask plane.
+
+    image_convert.py icon.png --name wifi_icon --mask > wifi_icon.h
+"""
+
+import argparse
+import os
+import re
+import sys
+
+
+def read_pbm(path):
+    """Returns (width, height, rows) where rows are lists of 0/1, 1 being a set pixel"""
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    tokens = []
+    pos = 0
+
+    def token():
+        nonlocal pos
+        while True:
+            while pos < len(data) and data[pos:pos + 1].isspace():
+                pos += 1
+            if data[pos:pos + 1] == b'#':
+                while pos < len(data) and data[pos:pos + 1] not in (b'\n', b'\r'):
+                    pos += 1
+                continue
+            break
+        start = pos
+        while pos < len(data) and not data[pos:pos + 1].isspace():
+            pos += 1
+        return data[start:pos]
+
+    magic = token()
+    width = int(token())
+    height = int(token())
+
+    if magic == b'P4':
+        pos += 1  # Single whitespace before raster
+        stride = (width + 7) // 8
+        rows = []
+        for y in range(height):
+            line = data[pos + y * stride:pos + (y + 1) * stride]
+            rows.append([(line[x // 8] >> (7 - x % 8)) & 1 for x in range(width)])
+        return width, height, rows
+
+    if magic == b'P1':
+        bits = [c - ord('0') for c in data[pos:] if c in (ord('0'), ord('1'))]
+        return width, height, [bits[y * width:(y + 1) * width] for y in range(height)]
+
+    sys.exit('%s: not a PBM file' % path)
+
+
+def read_image(path, threshold, invert):
+    """Returns (width, height, rows, alpha rows or None)"""
+    if path.lower().endswith('.pbm'):
+        width, height, rows = read_pbm(path)
+        if invert:
+            rows = [[1 - p for p in row] for row in rows]
+        return width, height, rows, None
+
+    try:
+        from PIL import Image
+    except ImportError:
+        sys.exit('Pillow is needed to read %s' % path)
+
+    image = Image.open(path).convert('RGBA')
+    width, height = image.size
+    pixels = image.load()
+    rows, alpha = [], []
+    for y in range(height):
+        row, arow = [], []
+        for x in range(width):
+            r, g, b, a = pixels[x, y]
+            on = (r * 299 + g * 587 + b * 114) // 1000 > threshold
+            row.append(int(on != invert))
+            arow.append(int(a >= 128))
+        rows.append(row)
+        alpha.append(arow)
+    return width, height, rows, alpha
+
+
+def to_pages(width, height, rows):
+    """Pack rows of pixels into page bytes, 8 vertical pixels per byte, LSB on top"""
+    out = []
+    for page in range((height + 7) // 8):
+        for x in range(width):
+            byte = 0
+            for bit in range(8):
+                y = page * 8 + bit
+                if y < height and rows[y][x]:
+                    byte |= 1 << bit
+            out.append(byte)
+    return out
+
+
+def c_array(name, data, width):
+    lines = ['static const uint8_t %s[] = {' % name]
+    for i in range(0, len(data), width):
+        lines.append('    ' + ', '.join('0x%02x' % b for b in data[i:i + width]) + ',')
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('image', help='PBM or PNG image')
+    parser.add_argument('--name', help='C identifier, defaults to the file name')
+    parser.add_argument('--mask', nargs='?', const=True, default=False,
+                        help='emit a mask plane from the alpha channel, or from the given PBM file')
+    parser.add_argument('--threshold', type=int, default=127, help='brightness threshold for non-PBM images')
+    parser.add_argument('--invert', action='store_true', help='invert the image bits')
+    args = parser.parse_args()
+
+    name = args.name or re.sub(r'\W', '_', os.path.splitext(os.path.basename(args.image))[0])
+    width, height, rows, alpha = read_image(args.image, args.threshold, args.invert)
+
+    if width > 65535 or height > 2040:
+        sys.exit('%s: images are limited to 65535x2040' % args.image)
+
+    mask = None
+    if args.mask is True:
+        if alpha is None:
+            sys.exit('%s: no alpha channel, give a PBM mask file' % args.image)
+        mask = alpha
+    elif args.mask:
+        mwidth, mheight, mask = read_pbm(args.mask)
+        if (mwidth, mheight) != (width, height):
+            sys.exit('%s: mask size differs from the image' % args.mask)
+
+    print('// Generated by image_convert.py from %s' % os.path.basename(args.image))
+    print('#include "SSD1306.h"')
+    print()
+    print(c_array('%s_bitmap' % name, to_pages(width, height, rows), min(width, 16)))
+    if mask is not None:
+        print()
+        print(c_array('%s_mask' % name, to_pages(width, height, mask), min(width, 16)))
+    print()
+    print('static const image_t %s = {%d, %d, IMAGE_TBLR, %s_bitmap, %s};' %
+          (name, width, height, name, '%s_mask' % name if mask is not None else 'nullptr'))
+
+
+if __name__ == '__main__':
+    main()